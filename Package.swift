@@ -11,6 +11,11 @@ let package = Package(
     products: [
         .library(name: "MusicPlayer", targets: ["MusicPlayer"]),
         .library(name: "LXMusicPlayer", targets: ["LXMusicPlayer"]),
+        .library(name: "MPRISServer", targets: ["MPRISServer"]),
+        .executable(name: "musicplayer-broker", targets: ["MusicPlayerBroker"]),
+        .executable(name: "musicplayer-mpris-soak", targets: ["MPRISSoak"]),
+        .executable(name: "musicplayer-monitor", targets: ["MusicPlayerMonitor"]),
+        .executable(name: "musicplayer-bench", targets: ["MusicPlayerBench"]),
     ],
     dependencies: [
         .package(url: "https://github.com/cx-org/CXShim", .upToNextMinor(from: "0.4.0")),
@@ -25,6 +30,7 @@ let package = Package(
                 .target(name: "LXMusicPlayer", condition: .when(platforms: [.macOS])),
                 .target(name: "MediaRemotePrivate", condition: .when(platforms: [.macOS, .iOS])),
                 .target(name: "playerctl", condition: .when(platforms: [.linux])),
+                .target(name: "NowPlayingSegment", condition: .when(platforms: [.macOS, .linux])),
             ], cSettings: [
                 .define("TARGET_OS_MAC", to: "1", .when(platforms: [.macOS, .iOS])),
                 .define("TARGET_OS_IPHONE", to: "1", .when(platforms: [.iOS])),
@@ -43,7 +49,65 @@ let package = Package(
                 .define("TARGET_OS_MAC", to: "1", .when(platforms: [.macOS, .iOS])),
                 .define("TARGET_OS_IPHONE", to: "1", .when(platforms: [.iOS])),
             ]),
+        .target(
+            name: "NowPlayingSegment",
+            linkerSettings: [
+                .linkedLibrary("rt", .when(platforms: [.linux])),
+            ]),
+        .target(
+            name: "MPRISServer",
+            dependencies: [
+                "MusicPlayer",
+                "CXShim",
+                .target(name: "gio", condition: .when(platforms: [.linux])),
+            ]),
+        .target(
+            name: "MusicPlayerBroker",
+            dependencies: [
+                "MusicPlayer",
+                "CXShim",
+                .target(name: "MPRISServer", condition: .when(platforms: [.linux])),
+            ]),
+        .target(
+            name: "MPRISMock",
+            dependencies: [
+                .target(name: "gio", condition: .when(platforms: [.linux])),
+            ]),
+        .target(
+            name: "MPRISSoak",
+            dependencies: [
+                "MusicPlayer",
+                "MPRISMock",
+                "CXShim",
+                .target(name: "gio", condition: .when(platforms: [.linux])),
+            ]),
+        .target(
+            name: "MusicPlayerMonitor",
+            dependencies: [
+                "MusicPlayer",
+                "CXShim",
+                .target(name: "gio", condition: .when(platforms: [.linux])),
+            ]),
+        .target(
+            name: "MusicPlayerBench",
+            dependencies: [
+                "MusicPlayer",
+                "AllocationCounter",
+                "CXShim",
+                .target(name: "gio", condition: .when(platforms: [.linux])),
+            ]),
+        .target(name: "AllocationCounter"),
+        .testTarget(
+            name: "MusicPlayerTests",
+            dependencies: [
+                "MusicPlayer",
+                "CXShim",
+                .target(name: "NowPlayingSegment", condition: .when(platforms: [.macOS, .linux])),
+                .target(name: "MPRISMock", condition: .when(platforms: [.linux])),
+                .target(name: "gio", condition: .when(platforms: [.linux])),
+            ]),
         .systemLibrary(name: "playerctl", pkgConfig: "playerctl"),
+        .systemLibrary(name: "gio", pkgConfig: "gio-2.0"),
     ]
 )
 
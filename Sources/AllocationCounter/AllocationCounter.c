@@ -0,0 +1,57 @@
+//
+//  AllocationCounter.c
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#include "AllocationCounter.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#if defined(__linux__) && defined(__GLIBC__)
+
+/* The allocator behind the public names, exported by glibc. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+static _Atomic int64_t allocations = 0;
+
+void *malloc(size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+bool lx_allocation_counter_is_available(void) {
+    return true;
+}
+
+int64_t lx_allocation_count(void) {
+    return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+
+#else
+
+bool lx_allocation_counter_is_available(void) {
+    return false;
+}
+
+int64_t lx_allocation_count(void) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,32 @@
+//
+//  AllocationCounter.h
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#ifndef AllocationCounter_h
+#define AllocationCounter_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Whether heap allocations of this process can be counted. Only with
+/// glibc, where the counter replaces `malloc`, `calloc` and `realloc` of
+/// the executable that links it.
+bool lx_allocation_counter_is_available(void);
+
+/// Heap allocations made by all threads since the process started.
+int64_t lx_allocation_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AllocationCounter_h */
@@ -0,0 +1,182 @@
+//
+//  MockMPRISFleet.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if os(Linux)
+
+import Foundation
+import gio
+
+/// Many `MockMPRISPlayer`s, changing on their own at configurable rates.
+///
+/// Events of each kind arrive as a Poisson process, independently for every
+/// player. The fleet is driven by a timer on the default main context, so
+/// a GLib main loop has to run it.
+public final class MockMPRISFleet {
+    
+    public struct Configuration {
+        
+        public var playerCount = 10
+        
+        /// Players are named `org.mpris.MediaPlayer2.<namePrefix><index>`.
+        public var namePrefix = "mock"
+        
+        /// Track changes per second, per player.
+        public var metadataRate: Double = 0.1
+        
+        /// Play or pause per second, per player.
+        public var statusRate: Double = 0.05
+        
+        /// Seeks per second, per player.
+        public var seekRate: Double = 0.05
+        
+        /// Mean time a player stays on the bus before it vanishes. Zero
+        /// keeps players on the bus.
+        public var meanLifetime: TimeInterval = 0
+        
+        /// Time a vanished player stays away.
+        public var downtime: TimeInterval = 5
+        
+        /// Resolution of the schedule.
+        public var tickInterval: TimeInterval = 0.01
+        
+        public init() {}
+    }
+    
+    /// Events emitted so far.
+    public struct Counters {
+        public var metadata = 0
+        public var status = 0
+        public var seeks = 0
+        public var appearances = 0
+        public var vanishes = 0
+        
+        public var changes: Int {
+            return metadata + status + seeks
+        }
+    }
+    
+    private struct Schedule {
+        var metadata: TimeInterval
+        var status: TimeInterval
+        var seek: TimeInterval
+        var lifecycle: TimeInterval
+    }
+    
+    public let configuration: Configuration
+    public let players: [MockMPRISPlayer]
+    public private(set) var counters = Counters()
+    
+    private var schedules: [Schedule] = []
+    private var sourceID: guint = 0
+    
+    public init?(address: String, configuration: Configuration) {
+        var players: [MockMPRISPlayer] = []
+        for index in 0..<configuration.playerCount {
+            let name = "\(configuration.namePrefix)\(index)"
+            guard let player = MockMPRISPlayer(address: address, busName: "org.mpris.MediaPlayer2.\(name)", identity: name) else {
+                return nil
+            }
+            players.append(player)
+        }
+        self.configuration = configuration
+        self.players = players
+    }
+    
+    deinit {
+        stop()
+    }
+    
+    public var isRunning: Bool {
+        return sourceID != 0
+    }
+    
+    /// Puts all players on the bus and starts the schedule.
+    public func start() {
+        guard sourceID == 0 else {
+            return
+        }
+        let now = MockClock.now
+        schedules = players.map { player -> Schedule in
+            player.appear()
+            counters.appearances += 1
+            return Schedule(metadata: now + delay(rate: configuration.metadataRate),
+                            status: now + delay(rate: configuration.statusRate),
+                            seek: now + delay(rate: configuration.seekRate),
+                            lifecycle: now + lifetime())
+        }
+        let onTick: @convention(c) (gpointer?) -> gboolean = { data in
+            Unmanaged<MockMPRISFleet>.fromOpaque(data!).takeUnretainedValue().tick()
+            return 1 // G_SOURCE_CONTINUE
+        }
+        let milliseconds = guint(max(1, (configuration.tickInterval * 1000).rounded()))
+        sourceID = g_timeout_add(milliseconds, onTick, Unmanaged.passUnretained(self).toOpaque())
+    }
+    
+    /// Stops the schedule and takes all players off the bus.
+    public func stop() {
+        guard sourceID != 0 else {
+            return
+        }
+        g_source_remove(sourceID)
+        sourceID = 0
+        for player in players where player.isOnBus {
+            player.vanish()
+            counters.vanishes += 1
+        }
+    }
+    
+    private func tick() {
+        let now = MockClock.now
+        for (index, player) in players.enumerated() {
+            if schedules[index].lifecycle <= now {
+                if player.isOnBus {
+                    player.vanish()
+                    counters.vanishes += 1
+                    schedules[index].lifecycle = now + configuration.downtime
+                } else {
+                    player.appear()
+                    counters.appearances += 1
+                    schedules[index].lifecycle = now + lifetime()
+                }
+            }
+            guard player.isOnBus else {
+                continue
+            }
+            if schedules[index].metadata <= now {
+                player.nextTrack()
+                counters.metadata += 1
+                schedules[index].metadata = now + delay(rate: configuration.metadataRate)
+            }
+            if schedules[index].status <= now {
+                player.setPlaying(!player.isPlaying)
+                counters.status += 1
+                schedules[index].status = now + delay(rate: configuration.statusRate)
+            }
+            if schedules[index].seek <= now {
+                player.seek(to: TimeInterval.random(in: 0..<player.trackLength))
+                counters.seeks += 1
+                schedules[index].seek = now + delay(rate: configuration.seekRate)
+            }
+        }
+    }
+    
+    private func lifetime() -> TimeInterval {
+        return configuration.meanLifetime > 0 ? delay(rate: 1 / configuration.meanLifetime) : .infinity
+    }
+    
+    /// Exponentially distributed, so events form a Poisson process.
+    private func delay(rate: Double) -> TimeInterval {
+        guard rate > 0 else {
+            return .infinity
+        }
+        return -log(Double.random(in: Double.leastNonzeroMagnitude..<1)) / rate
+    }
+}
+
+#endif
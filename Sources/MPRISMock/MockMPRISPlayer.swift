@@ -0,0 +1,319 @@
+//
+//  MockMPRISPlayer.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if os(Linux)
+
+import Foundation
+import gio
+
+/// A fake `org.mpris.MediaPlayer2` service, driven by calling its methods.
+///
+/// Every metadata map carries `emittedAtKey`, the `MockClock` time of the
+/// change, so that a client can measure how long the change took to reach
+/// it. Signals are dispatched on the thread-default main context of the
+/// thread that created the player.
+public final class MockMPRISPlayer {
+    
+    public static let emittedAtKey = "mock:emittedAt"
+    
+    static let objectPath = "/org/mpris/MediaPlayer2"
+    static let rootInterface = "org.mpris.MediaPlayer2"
+    static let playerInterface = "org.mpris.MediaPlayer2.Player"
+    
+    public let busName: String
+    public let identity: String
+    public let trackLength: TimeInterval
+    
+    public private(set) var trackNumber = 1
+    public private(set) var isPlaying = true
+    
+    public var isOnBus: Bool {
+        return ownerID != 0
+    }
+    
+    public var position: TimeInterval {
+        guard isPlaying else {
+            return positionBase
+        }
+        return min(trackLength, positionBase + MockClock.now - positionUpdatedAt)
+    }
+    
+    private let connection: OpaquePointer /* GDBusConnection* */
+    private var registrations: [guint] = []
+    private var ownerID: guint = 0
+    private var positionBase: TimeInterval = 0
+    private var positionUpdatedAt = MockClock.now
+    private var emittedAt = MockClock.now
+    
+    /// Connects to the bus at `address`. The player is not on the bus until
+    /// `appear()` is called.
+    public init?(address: String, busName: String, identity: String, trackLength: TimeInterval = 240) {
+        let flags = GDBusConnectionFlags(rawValue: G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT.rawValue
+                                            | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION.rawValue)
+        var error: UnsafeMutablePointer<GError>?
+        guard let connection = g_dbus_connection_new_for_address_sync(address, flags, nil, nil, &error) else {
+            g_clear_error(&error)
+            return nil
+        }
+        self.connection = connection
+        self.busName = busName
+        self.identity = identity
+        self.trackLength = trackLength
+        
+        let pself = Unmanaged.passUnretained(self).toOpaque()
+        for interface in [MockMPRISPlayer.rootInterface, MockMPRISPlayer.playerInterface] {
+            let info = g_dbus_node_info_lookup_interface(MockMPRISPlayer.nodeInfo, interface)
+            let id = g_dbus_connection_register_object(connection, MockMPRISPlayer.objectPath, info,
+                                                       MockMPRISPlayer.vtable, pself, nil, &error)
+            guard id != 0 else {
+                g_clear_error(&error)
+                return nil
+            }
+            registrations.append(id)
+        }
+    }
+    
+    deinit {
+        vanish()
+        for id in registrations {
+            g_dbus_connection_unregister_object(connection, id)
+        }
+        g_dbus_connection_close_sync(connection, nil, nil)
+        g_object_unref(UnsafeMutableRawPointer(connection))
+    }
+    
+    // MARK: - Script
+    
+    /// Takes the bus name, so that clients discover the player.
+    public func appear() {
+        guard ownerID == 0 else {
+            return
+        }
+        ownerID = g_bus_own_name_on_connection(connection, busName, G_BUS_NAME_OWNER_FLAGS_NONE, nil, nil, nil, nil)
+    }
+    
+    /// Releases the bus name, as if the player quit.
+    public func vanish() {
+        guard ownerID != 0 else {
+            return
+        }
+        g_bus_unown_name(ownerID)
+        ownerID = 0
+    }
+    
+    public func nextTrack() {
+        trackNumber += 1
+        setPosition(0)
+        emittedAt = MockClock.now
+        emitPropertiesChanged(["Metadata"])
+    }
+    
+    public func previousTrack() {
+        trackNumber = max(1, trackNumber - 1)
+        setPosition(0)
+        emittedAt = MockClock.now
+        emitPropertiesChanged(["Metadata"])
+    }
+    
+    public func setPlaying(_ playing: Bool) {
+        guard playing != isPlaying else {
+            return
+        }
+        setPosition(position)
+        isPlaying = playing
+        emitPropertiesChanged(["PlaybackStatus"])
+    }
+    
+    public func seek(to position: TimeInterval) {
+        setPosition(max(0, min(trackLength, position)))
+        let parameters: [OpaquePointer?] = [g_variant_new_int64(microseconds(positionBase))]
+        g_dbus_connection_emit_signal(connection, nil, MockMPRISPlayer.objectPath, MockMPRISPlayer.playerInterface,
+                                      "Seeked", g_variant_new_tuple(parameters, 1), nil)
+    }
+    
+    private func setPosition(_ position: TimeInterval) {
+        positionBase = position
+        positionUpdatedAt = MockClock.now
+    }
+    
+    // MARK: - D-Bus
+    
+    private func emitPropertiesChanged(_ properties: [String]) {
+        guard ownerID != 0 else {
+            return
+        }
+        let changed = MockMPRISPlayer.dictionary(properties.map { ($0, value(of: $0)!) })
+        let parameters: [OpaquePointer?] = [g_variant_new_string(MockMPRISPlayer.playerInterface), changed, g_variant_new_strv(nil, 0)]
+        g_dbus_connection_emit_signal(connection, nil, MockMPRISPlayer.objectPath, "org.freedesktop.DBus.Properties",
+                                      "PropertiesChanged", g_variant_new_tuple(parameters, 3), nil)
+    }
+    
+    /// A new floating `GVariant`, or `nil` for an unknown property.
+    private func value(of property: String) -> OpaquePointer? {
+        switch property {
+        case "PlaybackStatus":
+            return g_variant_new_string(isPlaying ? "Playing" : "Paused")
+        case "LoopStatus":
+            return g_variant_new_string("None")
+        case "Rate", "MinimumRate", "MaximumRate", "Volume":
+            return g_variant_new_double(1)
+        case "Metadata":
+            return metadata()
+        case "Position":
+            return g_variant_new_int64(microseconds(position))
+        case "CanGoNext", "CanGoPrevious", "CanPlay", "CanPause", "CanSeek", "CanControl":
+            return g_variant_new_boolean(1)
+        case "Shuffle", "CanQuit", "CanRaise", "HasTrackList":
+            return g_variant_new_boolean(0)
+        case "Identity":
+            return g_variant_new_string(identity)
+        case "SupportedUriSchemes", "SupportedMimeTypes":
+            return g_variant_new_strv(nil, 0)
+        default:
+            return nil
+        }
+    }
+    
+    private func metadata() -> OpaquePointer {
+        let artist = "\(identity) Artist".withCString { artist -> OpaquePointer in
+            let artists: [UnsafePointer<gchar>?] = [artist]
+            return g_variant_new_strv(artists, 1)
+        }
+        return MockMPRISPlayer.dictionary([
+            ("mpris:trackid", g_variant_new_object_path("\(MockMPRISPlayer.objectPath)/Track/\(trackNumber)")),
+            ("mpris:length", g_variant_new_int64(microseconds(trackLength))),
+            ("xesam:title", g_variant_new_string("Track \(trackNumber)")),
+            ("xesam:album", g_variant_new_string("\(identity) Album")),
+            ("xesam:artist", artist),
+            (MockMPRISPlayer.emittedAtKey, g_variant_new_double(emittedAt)),
+        ])
+    }
+    
+    private func handleMethodCall(_ method: String, parameters: OpaquePointer?) {
+        switch method {
+        case "Play":
+            setPlaying(true)
+        case "Pause", "Stop":
+            setPlaying(false)
+        case "PlayPause":
+            setPlaying(!isPlaying)
+        case "Next":
+            nextTrack()
+        case "Previous":
+            previousTrack()
+        case "Seek":
+            seek(to: position + MockMPRISPlayer.int64(parameters, at: 0) / 1_000_000)
+        case "SetPosition":
+            seek(to: MockMPRISPlayer.int64(parameters, at: 1) / 1_000_000)
+        default:
+            break
+        }
+    }
+    
+    private func microseconds(_ time: TimeInterval) -> gint64 {
+        return gint64(time * 1_000_000)
+    }
+    
+    private static func int64(_ tuple: OpaquePointer?, at index: Int) -> TimeInterval {
+        guard let tuple = tuple, gsize(index) < g_variant_n_children(tuple) else {
+            return 0
+        }
+        let child = g_variant_get_child_value(tuple, gsize(index))!
+        defer { g_variant_unref(child) }
+        return TimeInterval(g_variant_get_int64(child))
+    }
+    
+    /// A new floating `a{sv}`. Consumes the floating values.
+    private static func dictionary(_ entries: [(String, OpaquePointer)]) -> OpaquePointer {
+        let type = g_variant_type_new("a{sv}")
+        defer { g_variant_type_free(type) }
+        let builder = g_variant_builder_new(type)!
+        defer { g_variant_builder_unref(builder) }
+        for (key, value) in entries {
+            g_variant_builder_add_value(builder, g_variant_new_dict_entry(g_variant_new_string(key), g_variant_new_variant(value)))
+        }
+        return g_variant_builder_end(builder)
+    }
+}
+
+// MARK: - Introspection
+
+extension MockMPRISPlayer {
+    
+    private static let introspection = """
+        <node>
+          <interface name="org.mpris.MediaPlayer2">
+            <method name="Raise"/>
+            <method name="Quit"/>
+            <property name="CanQuit" type="b" access="read"/>
+            <property name="CanRaise" type="b" access="read"/>
+            <property name="HasTrackList" type="b" access="read"/>
+            <property name="Identity" type="s" access="read"/>
+            <property name="SupportedUriSchemes" type="as" access="read"/>
+            <property name="SupportedMimeTypes" type="as" access="read"/>
+          </interface>
+          <interface name="org.mpris.MediaPlayer2.Player">
+            <method name="Next"/>
+            <method name="Previous"/>
+            <method name="Pause"/>
+            <method name="PlayPause"/>
+            <method name="Stop"/>
+            <method name="Play"/>
+            <method name="Seek">
+              <arg direction="in" name="Offset" type="x"/>
+            </method>
+            <method name="SetPosition">
+              <arg direction="in" name="TrackId" type="o"/>
+              <arg direction="in" name="Position" type="x"/>
+            </method>
+            <method name="OpenUri">
+              <arg direction="in" name="Uri" type="s"/>
+            </method>
+            <signal name="Seeked">
+              <arg name="Position" type="x"/>
+            </signal>
+            <property name="PlaybackStatus" type="s" access="read"/>
+            <property name="LoopStatus" type="s" access="read"/>
+            <property name="Rate" type="d" access="read"/>
+            <property name="Shuffle" type="b" access="read"/>
+            <property name="Metadata" type="a{sv}" access="read"/>
+            <property name="Volume" type="d" access="read"/>
+            <property name="Position" type="x" access="read"/>
+            <property name="MinimumRate" type="d" access="read"/>
+            <property name="MaximumRate" type="d" access="read"/>
+            <property name="CanGoNext" type="b" access="read"/>
+            <property name="CanGoPrevious" type="b" access="read"/>
+            <property name="CanPlay" type="b" access="read"/>
+            <property name="CanPause" type="b" access="read"/>
+            <property name="CanSeek" type="b" access="read"/>
+            <property name="CanControl" type="b" access="read"/>
+          </interface>
+        </node>
+        """
+    
+    fileprivate static let nodeInfo: UnsafeMutablePointer<GDBusNodeInfo> = g_dbus_node_info_new_for_xml(introspection, nil)!
+    
+    // Never freed, registrations may outlive any one player.
+    fileprivate static let vtable: UnsafeMutablePointer<GDBusInterfaceVTable> = {
+        let vtable = UnsafeMutablePointer<GDBusInterfaceVTable>.allocate(capacity: 1)
+        vtable.initialize(to: GDBusInterfaceVTable())
+        vtable.pointee.method_call = { _, _, _, _, method, parameters, invocation, data in
+            let player = Unmanaged<MockMPRISPlayer>.fromOpaque(data!).takeUnretainedValue()
+            player.handleMethodCall(String(cString: method!), parameters: parameters)
+            g_dbus_method_invocation_return_value(invocation, nil)
+        }
+        vtable.pointee.get_property = { _, _, _, _, property, _, data in
+            let player = Unmanaged<MockMPRISPlayer>.fromOpaque(data!).takeUnretainedValue()
+            return player.value(of: String(cString: property!))
+        }
+        return vtable
+    }()
+}
+
+#endif
@@ -0,0 +1,76 @@
+//
+//  PrivateBus.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if os(Linux)
+
+import Foundation
+
+/// A `dbus-daemon` of its own, so that mock players never show up on the
+/// user's session bus. Stopped on deinit.
+public final class PrivateBus {
+    
+    /// Address to connect to, or to put in `DBUS_SESSION_BUS_ADDRESS`.
+    public let address: String
+    
+    private let process: Process
+    
+    public init?(executable: String = "dbus-daemon") {
+        let process = Process()
+        let output = Pipe()
+        process.executableURL = URL(fileURLWithPath: "/usr/bin/env")
+        process.arguments = [executable, "--session", "--nofork", "--print-address=1"]
+        process.standardOutput = output
+        do {
+            try process.run()
+        } catch {
+            return nil
+        }
+        
+        // The daemon prints its address once it's listening.
+        var data = Data()
+        while !data.contains(UInt8(ascii: "\n")) {
+            let chunk = output.fileHandleForReading.availableData
+            guard !chunk.isEmpty else {
+                process.terminate()
+                return nil
+            }
+            data.append(chunk)
+        }
+        guard let line = String(decoding: data, as: UTF8.self).split(separator: "\n").first else {
+            process.terminate()
+            return nil
+        }
+        self.address = String(line)
+        self.process = process
+    }
+    
+    deinit {
+        stop()
+    }
+    
+    public func stop() {
+        guard process.isRunning else {
+            return
+        }
+        process.terminate()
+        process.waitUntilExit()
+    }
+}
+
+/// `CLOCK_MONOTONIC`, which is the same in every process on the machine.
+public enum MockClock {
+    
+    public static var now: TimeInterval {
+        var time = timespec()
+        clock_gettime(CLOCK_MONOTONIC, &time)
+        return TimeInterval(time.tv_sec) + TimeInterval(time.tv_nsec) / 1_000_000_000
+    }
+}
+
+#endif
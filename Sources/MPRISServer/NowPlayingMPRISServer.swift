@@ -0,0 +1,438 @@
+//
+//  NowPlayingMPRISServer.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if os(Linux)
+
+import Foundation
+import CXShim
+import MusicPlayer
+import gio
+
+/// Exports one player, typically a `NowPlaying`, as the MPRIS player
+/// `org.mpris.MediaPlayer2.<name>`, so that other bus clients can watch one
+/// name instead of all of them.
+///
+/// Control calls are forwarded to the player. `PropertiesChanged` is only
+/// emitted for properties whose value actually changed, and a position
+/// jump emits `Seeked`. Method calls are dispatched by the GLib main loop.
+public final class NowPlayingMPRISServer {
+    
+    public let player: MusicPlayerProtocol
+    public let name: String
+    public let identity: String
+    
+    public var busName: String {
+        return "org.mpris.MediaPlayer2." + name
+    }
+    
+    /// Number of `PropertiesChanged` and `Seeked` signals emitted.
+    public var emittedSignalCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return signalCount
+    }
+    
+    private let connection: OpaquePointer /* GDBusConnection* */
+    private var registrations: [guint] = []
+    private var ownerID: guint = 0
+    private var cancellers: Set<AnyCancellable> = []
+    
+    // Last exported values, written on the player's queue and read on the
+    // GLib main loop.
+    private let lock = NSLock()
+    private var metadata: Metadata
+    private var state: PlaybackState
+    private var signalCount = 0
+    
+    /// Exports `player` on the session bus, or on the bus at `address`. A
+    /// `NowPlaying` player excludes `name` for as long as the server lives,
+    /// so that it never follows its own export. Its `selectionPolicy` is
+    /// left as it is.
+    public init?(player: MusicPlayerProtocol, name: String = "musicplayer", identity: String = "Now Playing", address: String? = nil) {
+        var error: UnsafeMutablePointer<GError>?
+        let connection: OpaquePointer?
+        if let address = address {
+            let flags = GDBusConnectionFlags(rawValue: G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT.rawValue
+                                                | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION.rawValue)
+            connection = g_dbus_connection_new_for_address_sync(address, flags, nil, nil, &error)
+        } else {
+            connection = g_bus_get_sync(G_BUS_TYPE_SESSION, nil, &error)
+        }
+        guard let bus = connection else {
+            g_clear_error(&error)
+            return nil
+        }
+        self.connection = bus
+        self.player = player
+        self.name = name
+        self.identity = identity
+        self.metadata = Metadata(player.currentTrack)
+        self.state = player.playbackState
+        
+        (player as? PlayerSelecting)?.excludePlayers(matching: name).store(in: &cancellers)
+        
+        // Each registration holds the reference until GLib is done with it,
+        // which may be after the server is gone.
+        let reference = ServerReference(self)
+        let releaseReference: GDestroyNotify = { data in
+            Unmanaged<ServerReference>.fromOpaque(data!).release()
+        }
+        for interface in [NowPlayingMPRISServer.rootInterface, NowPlayingMPRISServer.playerInterface] {
+            let info = g_dbus_node_info_lookup_interface(NowPlayingMPRISServer.nodeInfo, interface)
+            let data = Unmanaged.passRetained(reference).toOpaque()
+            let id = g_dbus_connection_register_object(bus, NowPlayingMPRISServer.objectPath, info,
+                                                       NowPlayingMPRISServer.vtable, data, releaseReference, &error)
+            guard id != 0 else {
+                // Not released, since GLib versions differ in whether they
+                // call `releaseReference` on failure. It's a few bytes.
+                g_clear_error(&error)
+                return nil
+            }
+            registrations.append(id)
+        }
+        
+        player.currentTrackWillChange
+            .sink { [weak self] track in
+                self?.trackWillChange(to: track)
+            }
+            .store(in: &cancellers)
+        player.playbackStateWillChange
+            .sink { [weak self] state in
+                self?.stateWillChange(to: state)
+            }
+            .store(in: &cancellers)
+        
+        ownerID = g_bus_own_name_on_connection(bus, busName, G_BUS_NAME_OWNER_FLAGS_NONE, nil, nil, nil, nil)
+    }
+    
+    deinit {
+        cancellers.removeAll()
+        if ownerID != 0 {
+            g_bus_unown_name(ownerID)
+        }
+        for id in registrations {
+            g_dbus_connection_unregister_object(connection, id)
+        }
+        g_object_unref(UnsafeMutableRawPointer(connection))
+    }
+    
+    // MARK: - Changes
+    
+    private func trackWillChange(to track: MusicTrack?) {
+        let newMetadata = Metadata(track)
+        lock.lock()
+        guard newMetadata != metadata else {
+            lock.unlock()
+            return
+        }
+        metadata = newMetadata
+        lock.unlock()
+        emitPropertiesChanged(["Metadata": newMetadata.variant()])
+    }
+    
+    private func stateWillChange(to newState: PlaybackState) {
+        lock.lock()
+        let oldState = state
+        state = newState
+        lock.unlock()
+        let status = NowPlayingMPRISServer.status(of: newState)
+        if status != NowPlayingMPRISServer.status(of: oldState) {
+            emitPropertiesChanged(["PlaybackStatus": g_variant_new_string(status)])
+        } else if newState != .stopped, !oldState.approximateEqual(to: newState) {
+            let parameters: [OpaquePointer?] = [g_variant_new_int64(microseconds(newState.time))]
+            emit("Seeked", interface: NowPlayingMPRISServer.playerInterface, parameters: parameters)
+        }
+    }
+    
+    private func emitPropertiesChanged(_ properties: [String: OpaquePointer]) {
+        let changed = NowPlayingMPRISServer.dictionary(properties.map { ($0.key, $0.value) })
+        let parameters: [OpaquePointer?] = [g_variant_new_string(NowPlayingMPRISServer.playerInterface), changed, g_variant_new_strv(nil, 0)]
+        emit("PropertiesChanged", interface: "org.freedesktop.DBus.Properties", parameters: parameters)
+    }
+    
+    private func emit(_ signal: String, interface: String, parameters: [OpaquePointer?]) {
+        lock.lock()
+        signalCount += 1
+        lock.unlock()
+        g_dbus_connection_emit_signal(connection, nil, NowPlayingMPRISServer.objectPath, interface,
+                                      signal, g_variant_new_tuple(parameters, gsize(parameters.count)), nil)
+    }
+    
+    // MARK: - D-Bus
+    
+    /// A new floating `GVariant`, or `nil` for an unknown property.
+    private func value(of property: String) -> OpaquePointer? {
+        lock.lock()
+        let metadata = self.metadata
+        let state = self.state
+        lock.unlock()
+        switch property {
+        case "PlaybackStatus":
+            return g_variant_new_string(NowPlayingMPRISServer.status(of: state))
+        case "LoopStatus":
+            return g_variant_new_string("None")
+        case "Rate", "MinimumRate", "MaximumRate", "Volume":
+            return g_variant_new_double(1)
+        case "Metadata":
+            return metadata.variant()
+        case "Position":
+            return g_variant_new_int64(microseconds(state.time))
+        case "CanGoNext", "CanGoPrevious", "CanPlay", "CanPause", "CanSeek", "CanControl":
+            return g_variant_new_boolean(1)
+        case "Shuffle", "CanQuit", "CanRaise", "HasTrackList":
+            return g_variant_new_boolean(0)
+        case "Identity":
+            return g_variant_new_string(identity)
+        case "SupportedUriSchemes", "SupportedMimeTypes":
+            return g_variant_new_strv(nil, 0)
+        default:
+            return nil
+        }
+    }
+    
+    /// Returns `false` for a method that isn't supported.
+    private func handleMethodCall(_ method: String, parameters: OpaquePointer?) -> Bool {
+        switch method {
+        case "Play":
+            player.resume()
+        case "Pause", "Stop":
+            player.pause()
+        case "PlayPause":
+            player.playPause()
+        case "Next":
+            player.skipToNextItem()
+        case "Previous":
+            player.skipToPreviousItem()
+        case "Seek":
+            player.playbackTime = max(0, player.playbackTime + NowPlayingMPRISServer.int64(parameters, at: 0) / 1_000_000)
+        case "SetPosition":
+            // Ignored unless it's for the current track, as the spec says.
+            lock.lock()
+            let trackID = metadata.trackID
+            lock.unlock()
+            if NowPlayingMPRISServer.objectPath(parameters, at: 0) == trackID {
+                player.playbackTime = NowPlayingMPRISServer.int64(parameters, at: 1) / 1_000_000
+            }
+        default:
+            // `Raise`, `Quit` and `OpenUri`, which `CanRaise`, `CanQuit`
+            // and the empty `SupportedUriSchemes` already rule out.
+            return false
+        }
+        return true
+    }
+    
+    private func microseconds(_ time: TimeInterval) -> gint64 {
+        return gint64(max(0, time) * 1_000_000)
+    }
+    
+    private static func status(of state: PlaybackState) -> String {
+        switch state {
+        case .playing, .fastForwarding, .rewinding:
+            return "Playing"
+        case .paused:
+            return "Paused"
+        case .stopped:
+            return "Stopped"
+        }
+    }
+    
+    private static func int64(_ tuple: OpaquePointer?, at index: Int) -> TimeInterval {
+        guard let tuple = tuple, gsize(index) < g_variant_n_children(tuple) else {
+            return 0
+        }
+        let child = g_variant_get_child_value(tuple, gsize(index))!
+        defer { g_variant_unref(child) }
+        return TimeInterval(g_variant_get_int64(child))
+    }
+    
+    private static func objectPath(_ tuple: OpaquePointer?, at index: Int) -> String? {
+        guard let tuple = tuple, gsize(index) < g_variant_n_children(tuple) else {
+            return nil
+        }
+        let child = g_variant_get_child_value(tuple, gsize(index))!
+        defer { g_variant_unref(child) }
+        return String(cString: g_variant_get_string(child, nil))
+    }
+    
+    /// A new floating `a{sv}`. Consumes the floating values.
+    fileprivate static func dictionary(_ entries: [(String, OpaquePointer)]) -> OpaquePointer {
+        let type = g_variant_type_new("a{sv}")
+        defer { g_variant_type_free(type) }
+        let builder = g_variant_builder_new(type)!
+        defer { g_variant_builder_unref(builder) }
+        for (key, value) in entries {
+            g_variant_builder_add_value(builder, g_variant_new_dict_entry(g_variant_new_string(key), g_variant_new_variant(value)))
+        }
+        return g_variant_builder_end(builder)
+    }
+}
+
+// MARK: - Metadata
+
+extension NowPlayingMPRISServer {
+    
+    /// The exported fields of a track, compared to find real changes.
+    fileprivate struct Metadata: Equatable {
+        
+        static let noTrack = "/org/mpris/MediaPlayer2/TrackList/NoTrack"
+        
+        var trackID = Metadata.noTrack
+        var length: gint64?
+        var title: String?
+        var album: String?
+        var artist: String?
+        var url: String?
+        var artURL: String?
+        
+        init(_ track: MusicTrack?) {
+            guard let track = track else {
+                return
+            }
+            // Backend ids are rarely valid object paths.
+            var hasher = StableHasher()
+            hasher.combine(track.id)
+            trackID = "/org/lyricsx/MusicPlayer/Track/T" + String(hasher.value, radix: 16)
+            length = track.duration.map { gint64($0 * 1_000_000) }
+            title = track.title
+            album = track.album
+            artist = track.artist
+            url = track.fileURL?.absoluteString
+            artURL = (track.artwork as Any as? URL)?.absoluteString
+        }
+        
+        /// A new floating `a{sv}`.
+        func variant() -> OpaquePointer {
+            var entries: [(String, OpaquePointer)] = [("mpris:trackid", g_variant_new_object_path(trackID))]
+            if let length = length {
+                entries.append(("mpris:length", g_variant_new_int64(length)))
+            }
+            if let title = title {
+                entries.append(("xesam:title", g_variant_new_string(title)))
+            }
+            if let album = album {
+                entries.append(("xesam:album", g_variant_new_string(album)))
+            }
+            if let artist = artist {
+                let artists = artist.withCString { artist -> OpaquePointer in
+                    let artists: [UnsafePointer<gchar>?] = [artist]
+                    return g_variant_new_strv(artists, 1)
+                }
+                entries.append(("xesam:artist", artists))
+            }
+            if let url = url {
+                entries.append(("xesam:url", g_variant_new_string(url)))
+            }
+            if let artURL = artURL {
+                entries.append(("mpris:artUrl", g_variant_new_string(artURL)))
+            }
+            return NowPlayingMPRISServer.dictionary(entries)
+        }
+    }
+}
+
+/// What the object registrations point to. A call that GLib dispatched
+/// while the server was going away finds no server, instead of a freed
+/// one.
+private final class ServerReference {
+    
+    weak var server: NowPlayingMPRISServer?
+    
+    init(_ server: NowPlayingMPRISServer) {
+        self.server = server
+    }
+}
+
+// MARK: - Introspection
+
+extension NowPlayingMPRISServer {
+    
+    static let objectPath = "/org/mpris/MediaPlayer2"
+    static let rootInterface = "org.mpris.MediaPlayer2"
+    static let playerInterface = "org.mpris.MediaPlayer2.Player"
+    
+    private static let introspection = """
+        <node>
+          <interface name="org.mpris.MediaPlayer2">
+            <method name="Raise"/>
+            <method name="Quit"/>
+            <property name="CanQuit" type="b" access="read"/>
+            <property name="CanRaise" type="b" access="read"/>
+            <property name="HasTrackList" type="b" access="read"/>
+            <property name="Identity" type="s" access="read"/>
+            <property name="SupportedUriSchemes" type="as" access="read"/>
+            <property name="SupportedMimeTypes" type="as" access="read"/>
+          </interface>
+          <interface name="org.mpris.MediaPlayer2.Player">
+            <method name="Next"/>
+            <method name="Previous"/>
+            <method name="Pause"/>
+            <method name="PlayPause"/>
+            <method name="Stop"/>
+            <method name="Play"/>
+            <method name="Seek">
+              <arg direction="in" name="Offset" type="x"/>
+            </method>
+            <method name="SetPosition">
+              <arg direction="in" name="TrackId" type="o"/>
+              <arg direction="in" name="Position" type="x"/>
+            </method>
+            <method name="OpenUri">
+              <arg direction="in" name="Uri" type="s"/>
+            </method>
+            <signal name="Seeked">
+              <arg name="Position" type="x"/>
+            </signal>
+            <property name="PlaybackStatus" type="s" access="read"/>
+            <property name="LoopStatus" type="s" access="read"/>
+            <property name="Rate" type="d" access="read"/>
+            <property name="Shuffle" type="b" access="read"/>
+            <property name="Metadata" type="a{sv}" access="read"/>
+            <property name="Volume" type="d" access="read"/>
+            <property name="Position" type="x" access="read"/>
+            <property name="MinimumRate" type="d" access="read"/>
+            <property name="MaximumRate" type="d" access="read"/>
+            <property name="CanGoNext" type="b" access="read"/>
+            <property name="CanGoPrevious" type="b" access="read"/>
+            <property name="CanPlay" type="b" access="read"/>
+            <property name="CanPause" type="b" access="read"/>
+            <property name="CanSeek" type="b" access="read"/>
+            <property name="CanControl" type="b" access="read"/>
+          </interface>
+        </node>
+        """
+    
+    fileprivate static let nodeInfo: UnsafeMutablePointer<GDBusNodeInfo> = g_dbus_node_info_new_for_xml(introspection, nil)!
+    
+    // Never freed, registrations may outlive any one server.
+    fileprivate static let vtable: UnsafeMutablePointer<GDBusInterfaceVTable> = {
+        let vtable = UnsafeMutablePointer<GDBusInterfaceVTable>.allocate(capacity: 1)
+        vtable.initialize(to: GDBusInterfaceVTable())
+        vtable.pointee.method_call = { _, _, _, _, method, parameters, invocation, data in
+            guard let server = Unmanaged<ServerReference>.fromOpaque(data!).takeUnretainedValue().server else {
+                g_dbus_method_invocation_return_error_literal(invocation, g_dbus_error_quark(), gint(G_DBUS_ERROR_UNKNOWN_OBJECT.rawValue), "The player is no longer exported")
+                return
+            }
+            if server.handleMethodCall(String(cString: method!), parameters: parameters) {
+                g_dbus_method_invocation_return_value(invocation, nil)
+            } else {
+                g_dbus_method_invocation_return_error_literal(invocation, g_dbus_error_quark(), gint(G_DBUS_ERROR_NOT_SUPPORTED.rawValue), "Not supported")
+            }
+        }
+        vtable.pointee.get_property = { _, _, _, _, property, error, data in
+            guard let server = Unmanaged<ServerReference>.fromOpaque(data!).takeUnretainedValue().server else {
+                g_set_error_literal(error, g_dbus_error_quark(), gint(G_DBUS_ERROR_UNKNOWN_OBJECT.rawValue), "The player is no longer exported")
+                return nil
+            }
+            return server.value(of: String(cString: property!))
+        }
+        return vtable
+    }()
+}
+
+#endif
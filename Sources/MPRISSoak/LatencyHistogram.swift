@@ -0,0 +1,57 @@
+//
+//  LatencyHistogram.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+/// Log-scale histogram with fixed memory, so that a soak of many hours
+/// doesn't grow because of its own samples. Percentiles are accurate to 5%.
+struct LatencyHistogram {
+    
+    // Buckets grow by 5%, from 1 µs up to 100 s.
+    private static let base = 1e-6
+    private static let growth = 1.05
+    private static let bucketCount = Int((log(1e8) / log(growth)).rounded(.up)) + 1
+    
+    private var buckets = [Int](repeating: 0, count: LatencyHistogram.bucketCount)
+    
+    private(set) var count = 0
+    private(set) var maximum: TimeInterval = 0
+    
+    mutating func record(_ value: TimeInterval) {
+        let index: Int
+        if value <= LatencyHistogram.base {
+            index = 0
+        } else {
+            index = min(LatencyHistogram.bucketCount - 1, Int(log(value / LatencyHistogram.base) / log(LatencyHistogram.growth)) + 1)
+        }
+        buckets[index] += 1
+        count += 1
+        maximum = max(maximum, value)
+    }
+    
+    /// Upper bound of the bucket holding the `p` quantile.
+    func percentile(_ p: Double) -> TimeInterval? {
+        guard count > 0 else {
+            return nil
+        }
+        let rank = max(1, Int((Double(count) * p).rounded(.up)))
+        var seen = 0
+        for (index, n) in buckets.enumerated() {
+            seen += n
+            if seen >= rank {
+                return min(maximum, LatencyHistogram.base * pow(LatencyHistogram.growth, Double(index)))
+            }
+        }
+        return maximum
+    }
+    
+    mutating func reset() {
+        self = LatencyHistogram()
+    }
+}
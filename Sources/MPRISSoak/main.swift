@@ -0,0 +1,342 @@
+//
+//  main.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+#if os(Linux)
+
+import CXShim
+import MusicPlayer
+import MPRISMock
+import gio
+
+let usage = """
+Usage: musicplayer-mpris-soak [options]
+
+Runs MPRISNowPlaying against a fleet of fake MPRIS players on a private
+dbus-daemon, and reports discovery time, event throughput, refresh latency
+and memory growth. Needs nothing but dbus-daemon.
+
+  --players N           Number of fake players (default: 50)
+  --metadata-rate R     Track changes per second, per player (default: 0.2)
+  --status-rate R       Play/pause toggles per second, per player (default: 0.1)
+  --seek-rate R         Seeks per second, per player (default: 0.1)
+  --lifetime S          Mean seconds a player stays on the bus, 0 for ever (default: 0)
+  --downtime S          Seconds a vanished player stays away (default: 5)
+  --duration S          Seconds to run (default: 60)
+  --report-interval S   Seconds between reports (default: 10)
+  --idle-threshold S    Seconds without playback before idle mode (default: 300)
+  --trace FILE          Trace events and write them to FILE as Chrome trace JSON
+"""
+
+var configuration = MockMPRISFleet.Configuration()
+configuration.playerCount = 50
+configuration.metadataRate = 0.2
+configuration.statusRate = 0.1
+configuration.seekRate = 0.1
+var duration: TimeInterval = 60
+var reportInterval: TimeInterval = 10
+var fleetMode = false
+var tracePath: String?
+var idlePolicy = IdlePolicy.default
+
+var arguments = CommandLine.arguments.dropFirst().makeIterator()
+func nextNumber(for argument: String) -> Double {
+    guard let value = arguments.next().flatMap(Double.init) else {
+        FileHandle.standardError.write("\(argument) needs a number\n\(usage)\n".data(using: .utf8)!)
+        exit(2)
+    }
+    return value
+}
+while let argument = arguments.next() {
+    switch argument {
+    case "--players":           configuration.playerCount = Int(nextNumber(for: argument))
+    case "--metadata-rate":     configuration.metadataRate = nextNumber(for: argument)
+    case "--status-rate":       configuration.statusRate = nextNumber(for: argument)
+    case "--seek-rate":         configuration.seekRate = nextNumber(for: argument)
+    case "--lifetime":          configuration.meanLifetime = nextNumber(for: argument)
+    case "--downtime":          configuration.downtime = nextNumber(for: argument)
+    case "--duration":          duration = nextNumber(for: argument)
+    case "--report-interval":   reportInterval = nextNumber(for: argument)
+    case "--idle-threshold":    idlePolicy.threshold = nextNumber(for: argument)
+    case "--trace":
+        guard let path = arguments.next() else {
+            FileHandle.standardError.write("\(argument) needs a path\n\(usage)\n".data(using: .utf8)!)
+            exit(2)
+        }
+        tracePath = path
+    // Internal: run only the fleet, on $DBUS_SESSION_BUS_ADDRESS.
+    case "--fleet":             fleetMode = true
+    case "-h", "--help":
+        print(usage)
+        exit(0)
+    default:
+        FileHandle.standardError.write("unknown argument: \(argument)\n\(usage)\n".data(using: .utf8)!)
+        exit(2)
+    }
+}
+
+func fail(_ message: String) -> Never {
+    FileHandle.standardError.write("\(message)\n".data(using: .utf8)!)
+    exit(1)
+}
+
+// MARK: - Fleet
+
+/// The fleet runs in a child process, like real players do, so that the
+/// memory and CPU of the soak only cover the client side.
+func runFleet() -> Never {
+    guard let address = ProcessInfo.processInfo.environment["DBUS_SESSION_BUS_ADDRESS"],
+        let fleet = MockMPRISFleet(address: address, configuration: configuration) else {
+        fail("failed to connect the fleet to the bus")
+    }
+    // Quit with the soak, which holds the other end of stdin.
+    Thread.detachNewThread {
+        while !FileHandle.standardInput.availableData.isEmpty {}
+        exit(0)
+    }
+    let onReport: @convention(c) (gpointer?) -> gboolean = { data in
+        let counters = Unmanaged<MockMPRISFleet>.fromOpaque(data!).takeUnretainedValue().counters
+        print("counters \(counters.metadata) \(counters.status) \(counters.seeks) \(counters.appearances) \(counters.vanishes)")
+        fflush(stdout)
+        return 1 // G_SOURCE_CONTINUE
+    }
+    withExtendedLifetime(fleet) {
+        fleet.start()
+        g_timeout_add(1000, onReport, Unmanaged.passUnretained(fleet).toOpaque())
+        g_main_loop_run(g_main_loop_new(nil, 0))
+    }
+    exit(0)
+}
+
+if fleetMode {
+    runFleet()
+}
+
+// MARK: - Soak
+
+func residentMemory() -> Int {
+    guard let status = try? String(contentsOfFile: "/proc/self/status"),
+        let line = status.split(separator: "\n").first(where: { $0.hasPrefix("VmRSS:") }),
+        let kilobytes = line.split(separator: " ").dropFirst().first.flatMap({ Int($0) }) else {
+        return 0
+    }
+    return kilobytes * 1024
+}
+
+func megabytes(_ bytes: Int) -> String {
+    return String(format: "%.1f MB", Double(bytes) / 1_048_576)
+}
+
+func milliseconds(_ time: TimeInterval?) -> String {
+    return time.map { String(format: "%.2f ms", $0 * 1000) } ?? "-"
+}
+
+final class Soak {
+    
+    let bus: PrivateBus
+    let nowPlaying: MusicPlayers.MPRISNowPlaying
+    let fleet = Process()
+    
+    let start = MockClock.now
+    let initialMemory = residentMemory()
+    var discoveryTime: TimeInterval?
+    
+    var subscriptions: [ObjectIdentifier: [AnyCancellable]] = [:]
+    var trackEvents = 0
+    var stateEvents = 0
+    var latency = LatencyHistogram()
+    var intervalLatency = LatencyHistogram()
+    var lastReport: (time: TimeInterval, events: Int) = (0, 0)
+    
+    // Written by the fleet output handler.
+    let lock = NSLock()
+    var fleetCounters: [Int] = [0, 0, 0, 0, 0]
+    var fleetOutput = Data()
+    
+    init(bus: PrivateBus, nowPlaying: MusicPlayers.MPRISNowPlaying) {
+        self.bus = bus
+        self.nowPlaying = nowPlaying
+        lastReport = (start, 0)
+    }
+    
+    func launchFleet() {
+        let arguments = ["--fleet",
+                         "--players", "\(configuration.playerCount)",
+                         "--metadata-rate", "\(configuration.metadataRate)",
+                         "--status-rate", "\(configuration.statusRate)",
+                         "--seek-rate", "\(configuration.seekRate)",
+                         "--lifetime", "\(configuration.meanLifetime)",
+                         "--downtime", "\(configuration.downtime)"]
+        let output = Pipe()
+        fleet.executableURL = URL(fileURLWithPath: "/proc/self/exe")
+        fleet.arguments = arguments
+        fleet.standardInput = Pipe()
+        fleet.standardOutput = output
+        output.fileHandleForReading.readabilityHandler = { [unowned self] handle in
+            self.readFleetOutput(handle.availableData)
+        }
+        fleet.terminationHandler = { [unowned self] process in
+            self.bus.stop()
+            fail("fleet exited with status \(process.terminationStatus)")
+        }
+        do {
+            try fleet.run()
+        } catch {
+            fail("failed to launch the fleet: \(error)")
+        }
+    }
+    
+    private func readFleetOutput(_ data: Data) {
+        lock.lock()
+        defer { lock.unlock() }
+        fleetOutput.append(data)
+        while let newline = fleetOutput.firstIndex(of: UInt8(ascii: "\n")) {
+            let line = String(decoding: fleetOutput[..<newline], as: UTF8.self)
+            fleetOutput.removeSubrange(...newline)
+            let fields = line.split(separator: " ")
+            if fields.first == "counters" {
+                fleetCounters = fields.dropFirst().compactMap { Int($0) }
+            }
+        }
+    }
+    
+    /// Runs on the GLib main loop, like the players themselves.
+    func sample() {
+        let now = MockClock.now
+        let players = nowPlaying.players.compactMap { $0 as? MusicPlayers.MPRIS }
+        if discoveryTime == nil && players.count >= configuration.playerCount {
+            discoveryTime = now - start
+        }
+        
+        var present = Set<ObjectIdentifier>()
+        for player in players {
+            let id = ObjectIdentifier(player)
+            present.insert(id)
+            guard subscriptions[id] == nil else {
+                continue
+            }
+            subscriptions[id] = [
+                player.currentTrackWillChange.dropFirst().traceDelivery().sink { [unowned self] track in
+                    self.trackDidChange(track)
+                },
+                player.playbackStateWillChange.dropFirst().traceDelivery().sink { [unowned self] _ in
+                    self.stateEvents += 1
+                },
+            ]
+        }
+        subscriptions = subscriptions.filter { present.contains($0.key) }
+        
+        if now - lastReport.time >= reportInterval {
+            report(at: now, playerCount: players.count)
+        }
+        if now - start >= duration {
+            finish(at: now, playerCount: players.count)
+        }
+    }
+    
+    private func trackDidChange(_ track: MusicTrack?) {
+        trackEvents += 1
+        guard let emittedAt = track?.mprisMetadata?.double(forKey: MockMPRISPlayer.emittedAtKey) else {
+            return
+        }
+        let latency = MockClock.now - emittedAt
+        self.latency.record(latency)
+        intervalLatency.record(latency)
+    }
+    
+    private var emittedChanges: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return fleetCounters.prefix(3).reduce(0, +)
+    }
+    
+    private func report(at now: TimeInterval, playerCount: Int) {
+        let events = trackEvents + stateEvents
+        let rate = Double(events - lastReport.events) / (now - lastReport.time)
+        let memory = residentMemory()
+        print(String(format: "[%6.0fs] ", now - start)
+            + "players \(playerCount)/\(configuration.playerCount)  "
+            + "events \(events) (\(String(format: "%.1f", rate))/s, fleet emitted \(emittedChanges))  "
+            + "track latency p50 \(milliseconds(intervalLatency.percentile(0.5))) p99 \(milliseconds(intervalLatency.percentile(0.99)))  "
+            + "rss \(megabytes(memory)) (\(memory >= initialMemory ? "+" : "-")\(megabytes(abs(memory - initialMemory))))")
+        fflush(stdout)
+        intervalLatency.reset()
+        lastReport = (now, events)
+    }
+    
+    private func finish(at now: TimeInterval, playerCount: Int) -> Never {
+        let elapsed = now - start
+        let events = trackEvents + stateEvents
+        let memory = residentMemory()
+        let growth = memory - initialMemory
+        let wakeups = nowPlaying.wakeups
+        lock.lock()
+        let counters = fleetCounters
+        lock.unlock()
+        print()
+        print("""
+            players:          \(playerCount)/\(configuration.playerCount), all discovered in \(discoveryTime.map { String(format: "%.3f s", $0) } ?? "-")
+            duration:         \(String(format: "%.0f s", elapsed))
+            fleet emitted:    \(counters.prefix(3).reduce(0, +)) changes, \(counters.dropFirst(3).first ?? 0) appearances, \(counters.dropFirst(4).first ?? 0) vanishes
+            events received:  \(events) (\(trackEvents) track, \(stateEvents) state), \(String(format: "%.1f", Double(events) / elapsed))/s
+            track latency:    p50 \(milliseconds(latency.percentile(0.5))), p90 \(milliseconds(latency.percentile(0.9))), p99 \(milliseconds(latency.percentile(0.99))), max \(milliseconds(latency.count > 0 ? latency.maximum : nil))
+            memory:           \(megabytes(initialMemory)) -> \(megabytes(memory)), \(String(format: "%+.2f", Double(growth) / 1_048_576 / elapsed * 3600)) MB/h
+            wakeups:          \(wakeups.signals) signals (\(wakeups.shedSignals) shed while idle), \(wakeups.polls) polls, \(wakeups.refreshes) reads
+            """)
+        if let path = tracePath {
+            print()
+            print(EventTracer.shared.summaryDescription)
+            do {
+                try EventTracer.shared.chromeTraceJSON().write(to: URL(fileURLWithPath: path))
+            } catch {
+                print("failed to write the trace: \(error)")
+            }
+        }
+        fflush(stdout)
+        fleet.terminationHandler = nil
+        fleet.terminate()
+        bus.stop()
+        exit(0)
+    }
+}
+
+signal(SIGPIPE, SIG_IGN)
+
+guard let bus = PrivateBus() else {
+    fail("failed to start dbus-daemon")
+}
+setenv("DBUS_SESSION_BUS_ADDRESS", bus.address, 1)
+
+guard let nowPlaying = MusicPlayers.MPRISNowPlaying() else {
+    bus.stop()
+    fail("failed to connect to the private bus")
+}
+EventTracer.isEnabled = tracePath != nil
+nowPlaying.idlePolicy = idlePolicy
+let soak = Soak(bus: bus, nowPlaying: nowPlaying)
+soak.launchFleet()
+
+let onSample: @convention(c) (gpointer?) -> gboolean = { data in
+    Unmanaged<Soak>.fromOpaque(data!).takeUnretainedValue().sample()
+    return 1 // G_SOURCE_CONTINUE
+}
+g_timeout_add(100, onSample, Unmanaged.passUnretained(soak).toOpaque())
+Thread.detachNewThread {
+    GRunLoop.main.run()
+}
+
+dispatchMain()
+
+#else
+
+print("musicplayer-mpris-soak needs MPRIS, which is only available on Linux")
+exit(1)
+
+#endif
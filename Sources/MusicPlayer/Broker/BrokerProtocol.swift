@@ -0,0 +1,276 @@
+//
+//  BrokerProtocol.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+// Every frame is a big-endian UInt32 length, followed by that many bytes: the
+// `PlayerBinaryEncoder` version, one message type byte and the message
+// payload, in that format.
+//
+// Server to client: `track` and `state`, sent once on connect and then on
+// every change of the served player.
+// Client to server: `command`.
+
+enum BrokerMessage {
+    
+    case track(MusicTrack?)
+    case state(PlaybackState)
+    case command(BrokerCommand)
+    
+    fileprivate enum Kind: UInt8 {
+        case track = 1
+        case state = 2
+        case command = 3
+    }
+}
+
+enum BrokerCommand {
+    
+    case resume
+    case pause
+    case playPause
+    case skipToNextItem
+    case skipToPreviousItem
+    case updatePlayerState
+    case seek(TimeInterval)
+    
+    fileprivate enum Kind: UInt8 {
+        case resume = 1
+        case pause = 2
+        case playPause = 3
+        case skipToNextItem = 4
+        case skipToPreviousItem = 5
+        case updatePlayerState = 6
+        case seek = 7
+    }
+}
+
+// MARK: - Encoding
+
+extension BrokerMessage {
+    
+    /// The complete frame, length prefix included.
+    var frame: [UInt8] {
+        var encoder = PlayerBinaryEncoder()
+        // The length prefix, filled in below.
+        for _ in 0..<4 {
+            encoder.write(0 as UInt8)
+        }
+        encoder.encodeVersion()
+        switch self {
+        case let .track(track):
+            encoder.write(Kind.track.rawValue)
+            encoder.encode(track)
+        case let .state(state):
+            encoder.write(Kind.state.rawValue)
+            encoder.encode(state)
+        case let .command(command):
+            encoder.write(Kind.command.rawValue)
+            switch command {
+            case .resume:               encoder.write(BrokerCommand.Kind.resume.rawValue)
+            case .pause:                encoder.write(BrokerCommand.Kind.pause.rawValue)
+            case .playPause:            encoder.write(BrokerCommand.Kind.playPause.rawValue)
+            case .skipToNextItem:       encoder.write(BrokerCommand.Kind.skipToNextItem.rawValue)
+            case .skipToPreviousItem:   encoder.write(BrokerCommand.Kind.skipToPreviousItem.rawValue)
+            case .updatePlayerState:    encoder.write(BrokerCommand.Kind.updatePlayerState.rawValue)
+            case let .seek(time):
+                encoder.write(BrokerCommand.Kind.seek.rawValue)
+                encoder.write(time)
+            }
+        }
+        var frame = encoder.bytes
+        let length = UInt32(frame.count - 4).bigEndian
+        withUnsafeBytes(of: length) { frame.replaceSubrange(0..<4, with: $0) }
+        return frame
+    }
+}
+
+// MARK: - Decoding
+
+extension BrokerMessage {
+    
+    /// Decodes the body of a frame (everything after the length prefix).
+    init?(body: ArraySlice<UInt8>) {
+        // A decoded track keeps the bytes it was read from, so it gets its
+        // own copy of the frame rather than the whole receive buffer.
+        var decoder = PlayerBinaryDecoder(Array(body))
+        guard decoder.decodeVersion(), let kind = decoder.readByte().flatMap(Kind.init(rawValue:)) else {
+            return nil
+        }
+        switch kind {
+        case .track:
+            guard let track = decoder.decodeTrack() else {
+                return nil
+            }
+            self = .track(track)
+        case .state:
+            guard let state = decoder.decodeState() else {
+                return nil
+            }
+            self = .state(state)
+        case .command:
+            switch decoder.readByte().flatMap(BrokerCommand.Kind.init(rawValue:)) {
+            case .resume?:              self = .command(.resume)
+            case .pause?:               self = .command(.pause)
+            case .playPause?:           self = .command(.playPause)
+            case .skipToNextItem?:      self = .command(.skipToNextItem)
+            case .skipToPreviousItem?:  self = .command(.skipToPreviousItem)
+            case .updatePlayerState?:   self = .command(.updatePlayerState)
+            case .seek?:
+                guard let time = decoder.readDouble() else { return nil }
+                self = .command(.seek(time))
+            case nil:
+                return nil
+            }
+        }
+    }
+}
+
+/// Splits a byte stream into frames.
+struct BrokerFrameParser {
+    
+    /// Frames larger than this are treated as a protocol error.
+    static let maximumFrameLength = 1 << 20
+    
+    private var buffer: [UInt8] = []
+    
+    /// Appends received bytes and returns the messages completed by them.
+    /// Returns `nil` if the stream is corrupt.
+    mutating func consume<Bytes: Collection>(_ bytes: Bytes) -> [BrokerMessage]? where Bytes.Element == UInt8 {
+        buffer.append(contentsOf: bytes)
+        var messages: [BrokerMessage] = []
+        var start = 0
+        while buffer.count - start >= 4 {
+            let length = buffer[start..<start + 4].reduce(0) { $0 << 8 | Int($1) }
+            guard length > 0, length <= BrokerFrameParser.maximumFrameLength else {
+                return nil
+            }
+            guard buffer.count - start - 4 >= length else {
+                break
+            }
+            guard let message = BrokerMessage(body: buffer[start + 4..<start + 4 + length]) else {
+                return nil
+            }
+            messages.append(message)
+            start += 4 + length
+        }
+        buffer.removeFirst(start)
+        return messages
+    }
+}
+
+// MARK: - Socket
+
+enum BrokerSocket {
+    
+    /// `$XDG_RUNTIME_DIR/musicplayer-broker.sock`, or a per-user path in
+    /// `/tmp` if there is no runtime directory.
+    static var defaultPath: String {
+        if let runtimeDirectory = ProcessInfo.processInfo.environment["XDG_RUNTIME_DIR"], !runtimeDirectory.isEmpty {
+            return runtimeDirectory + "/musicplayer-broker.sock"
+        }
+        return "/tmp/musicplayer-broker-\(getuid()).sock"
+    }
+    
+    private static func withAddress<R>(path: String, _ body: (UnsafePointer<sockaddr>, socklen_t) -> R) -> R? {
+        var address = sockaddr_un()
+        let pathBytes = Array(path.utf8CString)
+        guard pathBytes.count <= MemoryLayout.size(ofValue: address.sun_path) else {
+            return nil
+        }
+        address.sun_family = sa_family_t(AF_UNIX)
+        withUnsafeMutableBytes(of: &address.sun_path) { sunPath in
+            pathBytes.withUnsafeBytes { sunPath.copyMemory(from: $0) }
+        }
+        return withUnsafePointer(to: &address) {
+            $0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+                body($0, socklen_t(MemoryLayout<sockaddr_un>.size))
+            }
+        }
+    }
+    
+    private static func makeSocket() -> Int32 {
+        #if os(Linux)
+        let fd = socket(AF_UNIX, Int32(SOCK_STREAM.rawValue), 0)
+        #else
+        let fd = socket(AF_UNIX, SOCK_STREAM, 0)
+        var noSigPipe: Int32 = 1
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, socklen_t(MemoryLayout<Int32>.size))
+        #endif
+        return fd
+    }
+    
+    static func makeListener(path: String) -> Int32? {
+        let fd = makeSocket()
+        guard fd >= 0 else {
+            return nil
+        }
+        unlink(path)
+        let bound = withAddress(path: path) { bind(fd, $0, $1) == 0 } ?? false
+        guard bound, listen(fd, SOMAXCONN) == 0 else {
+            close(fd)
+            return nil
+        }
+        setNonBlocking(fd)
+        return fd
+    }
+    
+    static func makeConnection(path: String) -> Int32? {
+        let fd = makeSocket()
+        guard fd >= 0 else {
+            return nil
+        }
+        let connected = withAddress(path: path) { connect(fd, $0, $1) == 0 } ?? false
+        guard connected else {
+            close(fd)
+            return nil
+        }
+        return fd
+    }
+    
+    static func setNonBlocking(_ fd: Int32) {
+        _ = fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK)
+    }
+    
+    /// Writes as much as possible without blocking. Returns the number of
+    /// bytes written, or `nil` if the connection is broken.
+    static func write(_ fd: Int32, _ bytes: UnsafeRawBufferPointer) -> Int? {
+        #if os(Linux)
+        let flags = Int32(MSG_NOSIGNAL)
+        #else
+        let flags: Int32 = 0
+        #endif
+        var written = 0
+        while written < bytes.count {
+            let n = send(fd, bytes.baseAddress! + written, bytes.count - written, flags)
+            if n > 0 {
+                written += n
+            } else if n < 0 && errno == EINTR {
+                continue
+            } else if n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break
+            } else {
+                return nil
+            }
+        }
+        return written
+    }
+    
+    /// Reads whatever is available. Returns `nil` on EOF or error.
+    static func read(_ fd: Int32, into buffer: inout [UInt8]) -> Int? {
+        let n = buffer.withUnsafeMutableBytes { recv(fd, $0.baseAddress, $0.count, 0) }
+        if n > 0 {
+            return n
+        } else if n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0
+        } else {
+            return nil
+        }
+    }
+}
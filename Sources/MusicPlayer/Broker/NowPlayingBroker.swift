@@ -0,0 +1,257 @@
+//
+//  NowPlayingBroker.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// Serves the state of one player to any number of local processes over a
+/// Unix domain socket. Connect with `MusicPlayers.Broker`.
+///
+/// Each change is encoded once and the same frame is written to every
+/// client, so the player itself is watched only once per machine.
+public final class NowPlayingBroker {
+    
+    /// Clients whose unsent data grows beyond this are disconnected.
+    public static var maximumPendingBytes = 1 << 20
+    
+    public let path: String
+    public let player: MusicPlayerProtocol
+    
+    private let listener: Int32
+    private let queue = DispatchQueue(label: "ddddxxx.LyricsX.MusicPlayer.Broker")
+    private static let queueKey = DispatchSpecificKey<ObjectIdentifier>()
+    private let acceptSource: DispatchSourceRead
+    private var connections: [Int32: Connection] = [:]
+    private var cancellers: Set<AnyCancellable> = []
+    
+    private var trackFrame: [UInt8]
+    private var stateFrame: [UInt8]
+    
+    public var clientCount: Int {
+        return queue.sync { connections.count }
+    }
+    
+    public init?(player: MusicPlayerProtocol, path: String = MusicPlayers.Broker.defaultPath) {
+        guard let listener = BrokerSocket.makeListener(path: path) else {
+            return nil
+        }
+        self.path = path
+        self.player = player
+        self.listener = listener
+        self.trackFrame = BrokerMessage.track(player.currentTrack).frame
+        self.stateFrame = BrokerMessage.state(player.playbackState).frame
+        self.acceptSource = DispatchSource.makeReadSource(fileDescriptor: listener, queue: queue)
+        
+        acceptSource.setEventHandler { [weak self] in
+            self?.acceptConnections()
+        }
+        acceptSource.setCancelHandler {
+            close(listener)
+        }
+        acceptSource.resume()
+        
+        player.currentTrackWillChange
+            .sink { [weak self] track in
+                guard let self = self else { return }
+                let frame = BrokerMessage.track(track).frame
+                self.queue.async { [weak self] in
+                    self?.trackFrame = frame
+                    self?.broadcast(frame)
+                }
+            }
+            .store(in: &cancellers)
+        player.playbackStateWillChange
+            .sink { [weak self] state in
+                guard let self = self else { return }
+                let frame = BrokerMessage.state(state).frame
+                self.queue.async { [weak self] in
+                    self?.stateFrame = frame
+                    self?.broadcast(frame)
+                }
+            }
+            .store(in: &cancellers)
+        queue.setSpecific(key: NowPlayingBroker.queueKey, value: ObjectIdentifier(self))
+    }
+    
+    deinit {
+        cancellers.removeAll()
+        // Connections belong to the broker queue. Work queued before this
+        // finds the broker gone and returns.
+        let tearDown = {
+            self.acceptSource.cancel()
+            for connection in self.connections.values {
+                connection.onClose = nil
+                connection.disconnect()
+            }
+            self.connections.removeAll()
+        }
+        // The last reference may go away on the queue itself.
+        if DispatchQueue.getSpecific(key: NowPlayingBroker.queueKey) == ObjectIdentifier(self) {
+            tearDown()
+        } else {
+            queue.sync(execute: tearDown)
+        }
+        unlink(path)
+    }
+    
+    private func acceptConnections() {
+        while true {
+            let fd = accept(listener, nil, nil)
+            guard fd >= 0 else {
+                return
+            }
+            BrokerSocket.setNonBlocking(fd)
+            let connection = Connection(fd: fd, queue: queue)
+            connection.onMessage = { [weak self] message in
+                self?.handle(message)
+            }
+            connection.onClose = { [weak self] in
+                self?.connections[fd] = nil
+            }
+            connections[fd] = connection
+            connection.start()
+            connection.send(trackFrame)
+            connection.send(stateFrame)
+        }
+    }
+    
+    private func broadcast(_ frame: [UInt8]) {
+        for connection in connections.values {
+            connection.send(frame)
+        }
+    }
+    
+    private func handle(_ message: BrokerMessage) {
+        guard case let .command(command) = message else {
+            return
+        }
+        // Off the broker queue, where the player is updated, like the GLib
+        // main loop for MPRIS.
+        let player = self.player
+        player.performInContext {
+            switch command {
+            case .resume:               player.resume()
+            case .pause:                player.pause()
+            case .playPause:            player.playPause()
+            case .skipToNextItem:       player.skipToNextItem()
+            case .skipToPreviousItem:   player.skipToPreviousItem()
+            case .updatePlayerState:    player.updatePlayerState()
+            case let .seek(time):       player.playbackTime = time
+            }
+        }
+    }
+}
+
+extension NowPlayingBroker {
+    
+    /// One client. All methods run on the broker queue.
+    fileprivate final class Connection {
+        
+        let fd: Int32
+        
+        var onMessage: ((BrokerMessage) -> Void)?
+        var onClose: (() -> Void)?
+        
+        private let readSource: DispatchSourceRead
+        private let writeSource: DispatchSourceWrite
+        private var isWriteSourceActive = false
+        private var pending: [UInt8] = []
+        private var parser = BrokerFrameParser()
+        private var readBuffer = [UInt8](repeating: 0, count: 4096)
+        private var isClosed = false
+        
+        init(fd: Int32, queue: DispatchQueue) {
+            self.fd = fd
+            readSource = DispatchSource.makeReadSource(fileDescriptor: fd, queue: queue)
+            writeSource = DispatchSource.makeWriteSource(fileDescriptor: fd, queue: queue)
+        }
+        
+        func start() {
+            readSource.setEventHandler { [unowned self] in
+                self.readAvailable()
+            }
+            writeSource.setEventHandler { [unowned self] in
+                self.flush()
+            }
+            readSource.setCancelHandler { [fd] in
+                close(fd)
+            }
+            readSource.resume()
+        }
+        
+        func send(_ frame: [UInt8]) {
+            guard !isClosed else {
+                return
+            }
+            if pending.isEmpty {
+                let written = frame.withUnsafeBytes { BrokerSocket.write(fd, $0) }
+                guard let count = written else {
+                    disconnect()
+                    return
+                }
+                if count < frame.count {
+                    pending.append(contentsOf: frame[count...])
+                    resumeWriting()
+                }
+            } else {
+                guard pending.count + frame.count <= NowPlayingBroker.maximumPendingBytes else {
+                    disconnect()
+                    return
+                }
+                pending.append(contentsOf: frame)
+            }
+        }
+        
+        private func flush() {
+            let written = pending.withUnsafeBytes { BrokerSocket.write(fd, $0) }
+            guard let count = written else {
+                disconnect()
+                return
+            }
+            pending.removeFirst(count)
+            if pending.isEmpty, isWriteSourceActive {
+                writeSource.suspend()
+                isWriteSourceActive = false
+            }
+        }
+        
+        private func resumeWriting() {
+            if !isWriteSourceActive {
+                writeSource.resume()
+                isWriteSourceActive = true
+            }
+        }
+        
+        private func readAvailable() {
+            guard let count = BrokerSocket.read(fd, into: &readBuffer) else {
+                disconnect()
+                return
+            }
+            guard let messages = parser.consume(readBuffer[0..<count]) else {
+                disconnect()
+                return
+            }
+            messages.forEach { onMessage?($0) }
+        }
+        
+        func disconnect() {
+            guard !isClosed else {
+                return
+            }
+            isClosed = true
+            // A suspended source must be resumed before it can be released.
+            if !isWriteSourceActive {
+                writeSource.resume()
+            }
+            writeSource.cancel()
+            readSource.cancel()
+            onClose?()
+        }
+    }
+}
@@ -0,0 +1,260 @@
+//
+//  NowPlayingSegment.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if canImport(NowPlayingSegment)
+
+import Foundation
+import CXShim
+import NowPlayingSegment
+
+/// Mirrors the track and playback state of a player into a shared memory
+/// segment, for readers that need them on every frame. See
+/// `NowPlayingSegment.h` for the layout and the C reader API.
+///
+/// The segment is only written when the track or the playback state really
+/// changes. Readers extrapolate the position while playing.
+public final class NowPlayingSegmentPublisher {
+    
+    public static let defaultName = "/musicplayer-nowplaying"
+    
+    public let name: String
+    public let player: MusicPlayerProtocol
+    
+    private let segment: OpaquePointer /* LXNPSegment* */
+    private let queue = DispatchQueue(label: "ddddxxx.LyricsX.MusicPlayer.NowPlayingSegment")
+    private var cancellers: Set<AnyCancellable> = []
+    
+    private var track: MusicTrack?
+    private var state: PlaybackState
+    private var snapshot = LXNPSnapshot()
+    private var _writeCount = 0
+    
+    /// Number of writes to the segment so far.
+    public var writeCount: Int {
+        return queue.sync { _writeCount }
+    }
+    
+    public init?(player: MusicPlayerProtocol, name: String = NowPlayingSegmentPublisher.defaultName) {
+        guard let segment = LXNPSegmentCreate(name) else {
+            return nil
+        }
+        self.name = name
+        self.player = player
+        self.segment = segment
+        self.track = player.currentTrack
+        self.state = player.playbackState
+        snapshot.trackGeneration = 1
+        fillTrack()
+        fillState()
+        write()
+        
+        // Weak, since a change can still be queued while deinit drains the
+        // queue.
+        player.currentTrackWillChange
+            .sink { [weak self] track in
+                self?.queue.async { self?.update(track: track) }
+            }
+            .store(in: &cancellers)
+        player.playbackStateWillChange
+            .sink { [weak self] state in
+                self?.queue.async { self?.update(state: state) }
+            }
+            .store(in: &cancellers)
+    }
+    
+    deinit {
+        cancellers.removeAll()
+        queue.sync {}
+        LXNPSegmentClose(segment)
+        LXNPSegmentUnlink(name)
+    }
+    
+    private func update(track newTrack: MusicTrack?) {
+        if let track = track, let newTrack = newTrack,
+            track.id == newTrack.id,
+            track.title == newTrack.title,
+            track.artist == newTrack.artist,
+            track.album == newTrack.album,
+            track.duration == newTrack.duration {
+            return
+        } else if track == nil && newTrack == nil {
+            return
+        }
+        track = newTrack
+        snapshot.trackGeneration += 1
+        fillTrack()
+        write()
+    }
+    
+    private func update(state newState: PlaybackState) {
+        // Readers extrapolate, so a state that only moved on with the clock
+        // is not a change.
+        guard !newState.approximateEqual(to: state, tolerate: 0.05) else {
+            return
+        }
+        state = newState
+        fillState()
+        write()
+    }
+    
+    private func fillTrack() {
+        snapshot.hasTrack = track == nil ? 0 : 1
+        snapshot.trackHash = track.map { track in
+            var hasher = StableHasher()
+            hasher.combine(track.id)
+            return hasher.value
+        } ?? 0
+        snapshot.duration = track?.duration ?? -1
+        withUnsafeMutableBytes(of: &snapshot.trackID) { copy(track?.id, to: $0) }
+        withUnsafeMutableBytes(of: &snapshot.title) { copy(track?.title, to: $0) }
+        withUnsafeMutableBytes(of: &snapshot.artist) { copy(track?.artist, to: $0) }
+        withUnsafeMutableBytes(of: &snapshot.album) { copy(track?.album, to: $0) }
+    }
+    
+    private func fillState() {
+        let kind: LXNPPlaybackState
+        switch state {
+        case .stopped:          kind = LXNPPlaybackStateStopped
+        case .playing:          kind = LXNPPlaybackStatePlaying
+        case .paused:           kind = LXNPPlaybackStatePaused
+        case .fastForwarding:   kind = LXNPPlaybackStateFastForwarding
+        case .rewinding:        kind = LXNPPlaybackStateRewinding
+        }
+        snapshot.playbackState = numericCast(kind.rawValue)
+        snapshot.timestamp = LXNPCurrentTime()
+        snapshot.position = state.time
+        snapshot.rate = kind == LXNPPlaybackStatePlaying ? 1 : 0
+    }
+    
+    private func copy(_ string: String?, to field: UnsafeMutableRawBufferPointer) {
+        let pointer = field.baseAddress!.assumingMemoryBound(to: CChar.self)
+        if let string = string {
+            LXNPCopyString(pointer, string)
+        } else {
+            LXNPCopyString(pointer, nil)
+        }
+    }
+    
+    private func write() {
+        LXNPSegmentWrite(segment, &snapshot)
+        _writeCount += 1
+    }
+}
+
+/// Reads snapshots published by `NowPlayingSegmentPublisher`, possibly in
+/// another process.
+public final class NowPlayingSegmentReader {
+    
+    private let segment: OpaquePointer /* LXNPSegment* */
+    
+    public init?(name: String = NowPlayingSegmentPublisher.defaultName) {
+        guard let segment = LXNPSegmentOpen(name) else {
+            return nil
+        }
+        self.segment = segment
+    }
+    
+    deinit {
+        LXNPSegmentClose(segment)
+    }
+    
+    /// Takes a consistent snapshot, with no system calls and no allocation.
+    /// Returns `false` if nothing was published yet, or if the publisher
+    /// died in the middle of a write.
+    public func read(into snapshot: inout NowPlayingSnapshot) -> Bool {
+        return LXNPSegmentRead(segment, &snapshot.raw)
+    }
+    
+    public func read() -> NowPlayingSnapshot? {
+        var snapshot = NowPlayingSnapshot()
+        return read(into: &snapshot) ? snapshot : nil
+    }
+}
+
+public struct NowPlayingSnapshot {
+    
+    var raw = LXNPSnapshot()
+    
+    public init() {}
+    
+    /// Changes whenever the track changes, even to a track with the same id.
+    public var trackGeneration: UInt64 {
+        return raw.trackGeneration
+    }
+    
+    public var hasTrack: Bool {
+        return raw.hasTrack != 0
+    }
+    
+    /// Stable hash of the track id, zero if there is no track.
+    public var trackHash: UInt64 {
+        return raw.trackHash
+    }
+    
+    public var duration: TimeInterval? {
+        return raw.duration < 0 ? nil : raw.duration
+    }
+    
+    public var playbackState: PlaybackState {
+        switch LXNPPlaybackState(rawValue: numericCast(raw.playbackState)) {
+        case LXNPPlaybackStatePlaying:
+            return .playing(start: Date(timeIntervalSince1970: raw.timestamp - raw.position))
+        case LXNPPlaybackStatePaused:
+            return .paused(time: raw.position)
+        case LXNPPlaybackStateFastForwarding:
+            return .fastForwarding(time: raw.position)
+        case LXNPPlaybackStateRewinding:
+            return .rewinding(time: raw.position)
+        default:
+            return .stopped
+        }
+    }
+    
+    /// Position extrapolated to now.
+    public var position: TimeInterval {
+        var raw = self.raw
+        return LXNPSnapshotPosition(&raw, LXNPCurrentTime())
+    }
+    
+    /// Calls `body` with the UTF-8 track id, without copying it out.
+    public func withTrackID<R>(_ body: (UnsafeBufferPointer<UInt8>) throws -> R) rethrows -> R {
+        return try NowPlayingSnapshot.withString(raw.trackID, body)
+    }
+    
+    public var trackID: String? {
+        return hasTrack ? withTrackID { String(decoding: $0, as: UTF8.self) } : nil
+    }
+    
+    public var title: String? {
+        return NowPlayingSnapshot.string(raw.title)
+    }
+    
+    public var artist: String? {
+        return NowPlayingSnapshot.string(raw.artist)
+    }
+    
+    public var album: String? {
+        return NowPlayingSnapshot.string(raw.album)
+    }
+    
+    private static func withString<Field, R>(_ field: Field, _ body: (UnsafeBufferPointer<UInt8>) throws -> R) rethrows -> R {
+        return try withUnsafeBytes(of: field) { bytes in
+            let utf8 = bytes.bindMemory(to: UInt8.self)
+            let length = utf8.firstIndex(of: 0) ?? utf8.count
+            return try body(UnsafeBufferPointer(rebasing: utf8[..<length]))
+        }
+    }
+    
+    private static func string<Field>(_ field: Field) -> String? {
+        let string = withString(field) { String(decoding: $0, as: UTF8.self) }
+        return string.isEmpty ? nil : string
+    }
+}
+
+#endif
@@ -0,0 +1,66 @@
+//
+//  DuplicateMedia.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+/// Decides when two players expose the same media, such as a browser video
+/// that shows up both as `chromium.instance1234` and as
+/// `plasma-browser-integration`.
+///
+/// Players are duplicates when their tracks have the same content, and they
+/// are at the same position in the same playback state. Backend ids are not
+/// compared, since every endpoint makes up its own.
+public struct DuplicateMediaPolicy {
+    
+    /// Whether duplicates are looked for at all.
+    public var isEnabled: Bool
+    
+    /// Positions closer than this are the same.
+    public var positionTolerance: TimeInterval
+    
+    /// Durations closer than this are the same.
+    public var durationTolerance: TimeInterval
+    
+    public init(isEnabled: Bool = true, positionTolerance: TimeInterval = 1.5, durationTolerance: TimeInterval = 2) {
+        self.isEnabled = isEnabled
+        self.positionTolerance = positionTolerance
+        self.durationTolerance = durationTolerance
+    }
+    
+    public static let enabled = DuplicateMediaPolicy()
+    
+    public static let disabled = DuplicateMediaPolicy(isEnabled: false)
+    
+    /// What `isSameMedia` reads, and players must follow for it to work.
+    public var interest: PlayerChanges {
+        return isEnabled ? [.track, .title, .artist, .album, .duration, .fileURL, .stateKind] : []
+    }
+    
+    public func isSameMedia(_ player: MusicPlayerProtocol, _ other: MusicPlayerProtocol) -> Bool {
+        return isSameMedia((player.currentTrack, player.playbackState), (other.currentTrack, other.playbackState))
+    }
+    
+    /// Same as above, for a track and state that were read but not
+    /// published.
+    public func isSameMedia(_ media: (track: MusicTrack?, state: PlaybackState), _ other: (track: MusicTrack?, state: PlaybackState)) -> Bool {
+        guard isEnabled,
+            media.state != .stopped,
+            media.state.approximateEqual(to: other.state, tolerate: positionTolerance),
+            let track = media.track,
+            let otherTrack = other.track else {
+            return false
+        }
+        let fingerprint = track.fingerprint
+        let otherFingerprint = otherTrack.fingerprint
+        guard !fingerprint.isEmpty, !otherFingerprint.isEmpty else {
+            return false
+        }
+        return fingerprint.matches(otherFingerprint, durationTolerance: durationTolerance)
+    }
+}
@@ -0,0 +1,285 @@
+//
+//  EventTracer.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// Opt-in tracing of player events, from the signal that reports a change
+/// to the subscriber that receives it, to see where the time goes.
+///
+/// Each event gets a trace id and monotonic timestamps at these stages:
+///
+/// - `signal`: the MPRIS signal callback, after D-Bus and GLib dispatch.
+/// - `read`: the new state and track were read from the player.
+/// - `publish`: the published properties were set, so synchronous
+///   subscribers have run.
+/// - `hop`: `NowPlaying` received it on the player update queue.
+/// - `select`: `NowPlaying` re-selected its designated player.
+/// - `deliver`: a subscriber marked it with `traceDelivery()`.
+///
+/// Each stage is recorded once per trace, the first time it's reached, as
+/// one change can be published as several properties and reach several
+/// subscribers. Marks are kept in the order of the stages above, which is
+/// not always the order in time: synchronous subscribers deliver before
+/// the producer marks `publish`.
+///
+/// While `isEnabled` is `false`, a trace point costs one uncontended lock.
+public final class EventTracer {
+    
+    public static let shared = EventTracer()
+    
+    /// Set from any thread.
+    public static var isEnabled: Bool {
+        get {
+            enabledLock.lock()
+            defer { enabledLock.unlock() }
+            return _isEnabled
+        }
+        set {
+            enabledLock.lock()
+            _isEnabled = newValue
+            enabledLock.unlock()
+        }
+    }
+    
+    private static var _isEnabled = false
+    private static let enabledLock = NSLock()
+    
+    public enum Stage: String, CaseIterable {
+        case signal
+        case read
+        case publish
+        case hop
+        case select
+        case deliver
+    }
+    
+    public struct Mark {
+        public let stage: Stage
+        /// Monotonic, in nanoseconds.
+        public let timestamp: UInt64
+        public let thread: Int
+    }
+    
+    public struct Trace {
+        public let id: UInt64
+        public let name: String
+        public fileprivate(set) var marks: [Mark]
+    }
+    
+    /// Time between two consecutive stages of the traces.
+    public struct StageLatency {
+        public let from: Stage
+        public let to: Stage
+        public let count: Int
+        public let p50: TimeInterval
+        public let p90: TimeInterval
+        public let p99: TimeInterval
+        public let max: TimeInterval
+    }
+    
+    private let lock = NSLock()
+    private var ring: [Trace?]
+    private var nextID: UInt64 = 1
+    private var nextThreadID = 1
+    
+    /// Number of most recent traces kept, at least one.
+    public let capacity: Int
+    
+    public init(capacity: Int = 4096) {
+        self.capacity = max(1, capacity)
+        ring = Array(repeating: nil, count: self.capacity)
+    }
+    
+    /// Kept traces, oldest first.
+    public var traces: [Trace] {
+        lock.lock()
+        defer { lock.unlock() }
+        return ring.compactMap { $0 }.sorted { $0.id < $1.id }
+    }
+    
+    public func reset() {
+        lock.lock()
+        ring = Array(repeating: nil, count: capacity)
+        lock.unlock()
+    }
+    
+    // MARK: - Trace Points
+    
+    /// Starts a trace at the `signal` stage.
+    func begin(_ name: String) -> UInt64 {
+        let mark = Mark(stage: .signal, timestamp: DispatchTime.now().uptimeNanoseconds, thread: threadID)
+        lock.lock()
+        defer { lock.unlock() }
+        let id = nextID
+        nextID += 1
+        ring[Int(id % UInt64(capacity))] = Trace(id: id, name: name, marks: [mark])
+        return id
+    }
+    
+    func mark(_ stage: Stage, trace id: UInt64?) {
+        guard let id = id else {
+            return
+        }
+        let mark = Mark(stage: stage, timestamp: DispatchTime.now().uptimeNanoseconds, thread: threadID)
+        lock.lock()
+        defer { lock.unlock() }
+        let index = Int(id % UInt64(capacity))
+        guard ring[index]?.id == id, !ring[index]!.marks.contains(where: { $0.stage == stage }) else {
+            return
+        }
+        let order = stage.order
+        let position = ring[index]!.marks.firstIndex { $0.stage.order > order } ?? ring[index]!.marks.count
+        ring[index]!.marks.insert(mark, at: position)
+    }
+    
+    private static let currentTraceKey = "ddddxxx.LyricsX.MusicPlayer.EventTracer.current"
+    private static let threadIDKey = "ddddxxx.LyricsX.MusicPlayer.EventTracer.thread"
+    
+    /// The trace being delivered synchronously on this thread.
+    static var current: UInt64? {
+        guard isEnabled else {
+            return nil
+        }
+        return (Thread.current.threadDictionary[currentTraceKey] as? NSNumber)?.uint64Value
+    }
+    
+    /// Runs `body` with `trace` as the current trace of this thread.
+    static func withCurrent<R>(_ trace: UInt64?, _ body: () throws -> R) rethrows -> R {
+        guard let trace = trace else {
+            return try body()
+        }
+        let dictionary = Thread.current.threadDictionary
+        let previous = dictionary[currentTraceKey]
+        dictionary[currentTraceKey] = NSNumber(value: trace)
+        defer { dictionary[currentTraceKey] = previous }
+        return try body()
+    }
+    
+    private var threadID: Int {
+        let dictionary = Thread.current.threadDictionary
+        if let id = dictionary[EventTracer.threadIDKey] as? Int {
+            return id
+        }
+        lock.lock()
+        let id = nextThreadID
+        nextThreadID += 1
+        lock.unlock()
+        dictionary[EventTracer.threadIDKey] = id
+        return id
+    }
+}
+
+extension EventTracer.Stage {
+    
+    fileprivate var order: Int {
+        return EventTracer.Stage.allCases.firstIndex(of: self)!
+    }
+}
+
+extension EventTracer.Trace {
+    
+    /// Each mark after the first, from the mark of the closest earlier
+    /// stage that was reached before it in time. A synchronous `deliver`
+    /// is then measured from `read`, not from the later `publish`.
+    fileprivate var intervals: [(from: EventTracer.Mark, to: EventTracer.Mark)] {
+        var result: [(from: EventTracer.Mark, to: EventTracer.Mark)] = []
+        for index in marks.indices.dropFirst() {
+            let mark = marks[index]
+            if let from = marks[..<index].last(where: { $0.timestamp <= mark.timestamp }) {
+                result.append((from, mark))
+            }
+        }
+        return result
+    }
+}
+
+// MARK: - Export
+
+extension EventTracer {
+    
+    /// Latency between stages over all kept traces, in the order stages
+    /// happen. Each stage is measured from the closest earlier stage that
+    /// was reached before it.
+    public func summary() -> [StageLatency] {
+        var samples: [String: (from: Stage, to: Stage, durations: [TimeInterval])] = [:]
+        for trace in traces {
+            for (from, to) in trace.intervals {
+                let key = from.stage.rawValue + ">" + to.stage.rawValue
+                let duration = TimeInterval(to.timestamp &- from.timestamp) / 1_000_000_000
+                samples[key, default: (from.stage, to.stage, [])].durations.append(duration)
+            }
+        }
+        let order = Stage.allCases
+        return samples.values
+            .map { sample -> StageLatency in
+                let sorted = sample.durations.sorted()
+                func percentile(_ p: Double) -> TimeInterval {
+                    return sorted[min(sorted.count - 1, Int(Double(sorted.count) * p))]
+                }
+                return StageLatency(from: sample.from, to: sample.to, count: sorted.count,
+                                    p50: percentile(0.5), p90: percentile(0.9), p99: percentile(0.99), max: sorted.last!)
+            }
+            .sorted { (order.firstIndex(of: $0.from)!, order.firstIndex(of: $0.to)!) < (order.firstIndex(of: $1.from)!, order.firstIndex(of: $1.to)!) }
+    }
+    
+    /// `summary()` as a table.
+    public var summaryDescription: String {
+        func ms(_ time: TimeInterval) -> String {
+            return String(format: "%9.3f", time * 1000)
+        }
+        var lines = ["stage".padding(toLength: 18, withPad: " ", startingAt: 0) + "    count    p50 ms    p90 ms    p99 ms    max ms"]
+        for stage in summary() {
+            let name = "\(stage.from.rawValue) -> \(stage.to.rawValue)"
+            lines.append(name.padding(toLength: 18, withPad: " ", startingAt: 0)
+                + String(format: "%9d ", stage.count)
+                + [stage.p50, stage.p90, stage.p99, stage.max].map(ms).joined(separator: " "))
+        }
+        return lines.joined(separator: "\n")
+    }
+    
+    /// Kept traces in the Chrome trace event format, for `chrome://tracing`
+    /// or Perfetto. Each stage is a complete event on the thread it ended on.
+    public func chromeTraceJSON() -> Data {
+        let pid = Int(ProcessInfo.processInfo.processIdentifier)
+        var events: [[String: Any]] = []
+        for trace in traces {
+            guard let first = trace.marks.first, let last = trace.marks.max(by: { $0.timestamp < $1.timestamp }) else {
+                continue
+            }
+            events.append([
+                "name": trace.name, "cat": "event", "ph": "X", "pid": pid, "tid": first.thread,
+                "ts": Double(first.timestamp) / 1000, "dur": Double(last.timestamp &- first.timestamp) / 1000,
+                "args": ["trace": Int(truncatingIfNeeded: trace.id)],
+            ])
+            for (from, to) in trace.intervals {
+                events.append([
+                    "name": "\(from.stage.rawValue) -> \(to.stage.rawValue)", "cat": "stage", "ph": "X", "pid": pid, "tid": to.thread,
+                    "ts": Double(from.timestamp) / 1000, "dur": Double(to.timestamp &- from.timestamp) / 1000,
+                    "args": ["trace": Int(truncatingIfNeeded: trace.id)],
+                ])
+            }
+        }
+        let document: [String: Any] = ["traceEvents": events, "displayTimeUnit": "ms"]
+        return (try? JSONSerialization.data(withJSONObject: document)) ?? Data()
+    }
+}
+
+extension Publisher {
+    
+    /// Marks the `deliver` stage of the current trace for every value. Put
+    /// it right before the sink, with no scheduler hop in between.
+    public func traceDelivery() -> Publishers.HandleEvents<Self> {
+        return handleEvents(receiveOutput: { _ in
+            if EventTracer.isEnabled {
+                EventTracer.shared.mark(.deliver, trace: EventTracer.current)
+            }
+        })
+    }
+}
@@ -0,0 +1,81 @@
+//
+//  IdlePolicy.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+/// Decides when `MusicPlayers.MPRISNowPlaying` stops following players that
+/// have all been stopped or paused for a while.
+///
+/// While idle, only playback status and players appearing on the bus are
+/// watched, and nothing is read. The first player that starts playing, or
+/// appears, brings back full state.
+public struct IdlePolicy {
+    
+    /// Whether idle mode is entered at all.
+    public var isEnabled: Bool
+    
+    /// How long no player may play before idle mode is entered.
+    public var threshold: TimeInterval
+    
+    public init(isEnabled: Bool = true, threshold: TimeInterval = 300) {
+        self.isEnabled = isEnabled
+        self.threshold = threshold
+    }
+    
+    public static let `default` = IdlePolicy()
+    
+    public static let disabled = IdlePolicy(isEnabled: false)
+}
+
+/// What woke a player up, and the bus traffic it caused, to compare idle
+/// and active periods or find a slow player.
+public struct WakeupCounters {
+    
+    /// Change signals handled.
+    public internal(set) var signals = 0
+    
+    /// Polls of players that drop signals.
+    public internal(set) var polls = 0
+    
+    /// Reads of the player's state from the bus.
+    public internal(set) var refreshes = 0
+    
+    /// Signals ignored in idle mode.
+    public internal(set) var shedSignals = 0
+    
+    /// Reads and probes of the player over the bus.
+    public internal(set) var calls = 0
+    
+    /// Calls that got no answer in time.
+    public internal(set) var timeouts = 0
+    
+    /// Time spent reading state in refreshes.
+    public internal(set) var readTime: TimeInterval = 0
+    
+    public internal(set) var maximumReadTime: TimeInterval = 0
+    
+    public var averageReadTime: TimeInterval? {
+        return refreshes > 0 ? readTime / TimeInterval(refreshes) : nil
+    }
+    
+    public init() {}
+    
+    static func + (lhs: WakeupCounters, rhs: WakeupCounters) -> WakeupCounters {
+        var sum = lhs
+        sum.signals += rhs.signals
+        sum.polls += rhs.polls
+        sum.refreshes += rhs.refreshes
+        sum.shedSignals += rhs.shedSignals
+        sum.calls += rhs.calls
+        sum.timeouts += rhs.timeouts
+        sum.readTime += rhs.readTime
+        sum.maximumReadTime = max(lhs.maximumReadTime, rhs.maximumReadTime)
+        return sum
+    }
+}
@@ -13,10 +13,19 @@ import CXShim
 public protocol MusicPlayerProtocol: AnyObject {
     
     var name: MusicPlayerName? { get }
+    
+    /// Identifies the player application, such as a bundle identifier or
+    /// an MPRIS bus name.
+    var playerIdentifier: String { get }
+    
     var currentTrack: MusicTrack? { get }
     var playbackState: PlaybackState { get }
     var playbackTime: TimeInterval { get set }
     
+    /// Decides when the track has changed, for `changes`. `.backendID` by
+    /// default.
+    var trackIdentityPolicy: TrackIdentityPolicy { get }
+    
     var objectWillChange: ObservableObjectPublisher { get }
     var currentTrackWillChange: AnyPublisher<MusicTrack?, Never> { get }
     var playbackStateWillChange: AnyPublisher<PlaybackState, Never> { get }
@@ -29,11 +38,21 @@ public protocol MusicPlayerProtocol: AnyObject {
     func skipToPreviousItem()
     
     func updatePlayerState()
+    
+    /// Runs `body` where the player is updated, like the GLib main loop for
+    /// MPRIS, so that calls from other threads don't race with its updates.
+    /// Right away by default.
+    func performInContext(_ body: @escaping () -> Void)
 }
 
 public enum MusicPlayers {}
 
 public extension MusicPlayerProtocol {
+    
+    var playerIdentifier: String {
+        return name?.rawValue ?? String(describing: type(of: self))
+    }
+    
     func playPause() {
         if playbackState.isPlaying {
             pause()
@@ -41,4 +60,34 @@ public extension MusicPlayerProtocol {
             resume()
         }
     }
+    
+    func performInContext(_ body: @escaping () -> Void) {
+        body()
+    }
+    
+    var trackIdentityPolicy: TrackIdentityPolicy {
+        return .backendID
+    }
+}
+
+/// Whether `identifier` is `entry`, or an instance of it, like
+/// `"firefox.instance42"` for `"firefox"`. An entry without a bus, like
+/// `"mpd"`, matches the player on every bus, like `"mpd@system"`.
+func isPlayerIdentifier(_ identifier: String, matching entry: String) -> Bool {
+    if identifier == entry || identifier.hasPrefix(entry + ".") {
+        return true
+    }
+    // Bus names can't contain `@`, so the first one starts the bus.
+    guard let separator = identifier.firstIndex(of: "@") else {
+        return false
+    }
+    let name = identifier[..<separator]
+    if let entrySeparator = entry.firstIndex(of: "@") {
+        guard identifier[separator...] == entry[entrySeparator...] else {
+            return false
+        }
+        let entryName = entry[..<entrySeparator]
+        return name == entryName || name.hasPrefix(entryName + ".")
+    }
+    return name == entry || name.hasPrefix(entry + ".")
 }
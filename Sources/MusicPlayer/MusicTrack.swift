@@ -16,23 +16,95 @@ import ScriptingBridge
 public struct MusicTrack {
     
     public var id: String
-    public var title: String?
-    public var album: String?
-    public var artist: String?
-    public var duration: TimeInterval?
-    public var fileURL: URL?
-    public var artwork: Image?
+    
+    public var title: String? {
+        get { return resolve(_title) { $0.title } }
+        set {
+            _title = .some(newValue)
+            fingerprintCache = TrackFingerprintCache()
+        }
+    }
+    
+    public var album: String? {
+        get { return resolve(_album) { $0.album } }
+        set {
+            _album = .some(newValue)
+            fingerprintCache = TrackFingerprintCache()
+        }
+    }
+    
+    public var artist: String? {
+        get { return resolve(_artist) { $0.artist } }
+        set {
+            _artist = .some(newValue)
+            fingerprintCache = TrackFingerprintCache()
+        }
+    }
+    
+    public var duration: TimeInterval? {
+        get { return resolve(_duration) { $0.duration } }
+        set {
+            _duration = .some(newValue)
+            fingerprintCache = TrackFingerprintCache()
+        }
+    }
+    
+    public var fileURL: URL? {
+        get { return resolve(_fileURL) { $0.fileURL } }
+        set {
+            _fileURL = .some(newValue)
+            fingerprintCache = TrackFingerprintCache()
+        }
+    }
+    
+    public var artwork: Image? {
+        get { return resolve(_artwork) { $0.artwork } }
+        set { _artwork = .some(newValue) }
+    }
     
     public var originalTrack: AnyObject? = nil
     
+    // `nil` means the field hasn't been set and is read from `fieldSource`.
+    private var _title: String??
+    private var _album: String??
+    private var _artist: String??
+    private var _duration: TimeInterval??
+    private var _fileURL: URL??
+    private var _artwork: Image??
+    
+    private var fieldSource: MusicTrackFieldSource?
+    
+    // Shared by copies until one of them sets a field the fingerprint
+    // depends on.
+    private var fingerprintCache = TrackFingerprintCache()
+    
+    /// Content-based identity, computed once per track.
+    public var fingerprint: TrackFingerprint {
+        return fingerprintCache.value { TrackFingerprint(track: self) }
+    }
+    
+    private func resolve<T>(_ value: T??, _ decode: (MusicTrackFieldSource) -> T?) -> T? {
+        if let value = value {
+            return value
+        }
+        return fieldSource.flatMap(decode)
+    }
+    
     public init(id: String, title: String?, album: String?, artist: String?, duration: TimeInterval? = nil, fileURL: URL? = nil, artwork: Image? = nil, originalTrack: AnyObject? = nil) {
         self.id = id
-        self.title = title
-        self.album = album
-        self.artist = artist
-        self.duration = duration
-        self.fileURL = fileURL
-        self.artwork = artwork
+        self._title = .some(title)
+        self._album = .some(album)
+        self._artist = .some(artist)
+        self._duration = .some(duration)
+        self._fileURL = .some(fileURL)
+        self._artwork = .some(artwork)
+        self.originalTrack = originalTrack
+    }
+    
+    /// A track whose fields are decoded from `fieldSource` on first access.
+    init(id: String, fieldSource: MusicTrackFieldSource, originalTrack: AnyObject? = nil) {
+        self.id = id
+        self.fieldSource = fieldSource
         self.originalTrack = originalTrack
     }
     
@@ -43,6 +115,17 @@ public struct MusicTrack {
     #endif
 }
 
+/// Lazily decoded fields of a track. Implementations cache what they decode.
+protocol MusicTrackFieldSource: AnyObject {
+    
+    var title: String? { get }
+    var album: String? { get }
+    var artist: String? { get }
+    var duration: TimeInterval? { get }
+    var fileURL: URL? { get }
+    var artwork: Image? { get }
+}
+
 extension MusicTrack: Equatable, Hashable {
     
     public static func == (lhs: Self, rhs: Self) -> Bool {
@@ -0,0 +1,96 @@
+//
+//  OutputLatency.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// How far what the listener hears lags behind the position a player
+/// reports, keyed by `MusicPlayerProtocol.playerIdentifier`. Bluetooth and
+/// network sinks typically add 150–300 ms.
+///
+/// Players that support it subtract the latency from `playbackTime` and
+/// from the start of a `.playing` state, so everything downstream, such as
+/// `NowPlaying`, gets the corrected timing.
+public final class OutputLatency {
+    
+    public static let shared = OutputLatency()
+    
+    private let lock = NSLock()
+    private var latencies: [String: TimeInterval] = [:]
+    private let subject = PassthroughSubject<String, Never>()
+    
+    public init() {}
+    
+    /// Sends the identifier whose latency was set.
+    public var latencyDidChange: AnyPublisher<String, Never> {
+        return subject.eraseToAnyPublisher()
+    }
+    
+    /// All latencies that are set.
+    public var all: [String: TimeInterval] {
+        lock.lock()
+        defer { lock.unlock() }
+        return latencies
+    }
+    
+    /// Sets the latency of a player, or removes it with `nil`. A latency for
+    /// `"firefox"` also applies to `"firefox.instance42"`, and one for
+    /// `"mpd"` to `"mpd@system"`, like `PlayerSelectionPolicy.priority`.
+    public func setLatency(_ latency: TimeInterval?, for identifier: String) {
+        lock.lock()
+        latencies[identifier] = latency
+        lock.unlock()
+        subject.send(identifier)
+    }
+    
+    /// The latency of the player with `identifier`, zero if none is set. The
+    /// most specific entry that matches wins, the same rule that decides
+    /// which players `setLatency` notifies.
+    public func latency(for identifier: String) -> TimeInterval {
+        lock.lock()
+        defer { lock.unlock() }
+        if let latency = latencies[identifier] {
+            return latency
+        }
+        return latencies
+            .filter { isPlayerIdentifier(identifier, matching: $0.key) }
+            .max { $0.key.count < $1.key.count }?
+            .value ?? 0
+    }
+}
+
+extension MusicPlayerProtocol {
+    
+    /// Latency set for this player in `OutputLatency.shared`.
+    var outputLatency: TimeInterval {
+        return OutputLatency.shared.latency(for: playerIdentifier)
+    }
+    
+    /// Sends when the output latency of this player is set.
+    var outputLatencyDidChange: AnyPublisher<Void, Never> {
+        let identifier = playerIdentifier
+        return OutputLatency.shared.latencyDidChange
+            .filter { isPlayerIdentifier(identifier, matching: $0) }
+            .map { _ in () }
+            .eraseToAnyPublisher()
+    }
+}
+
+extension PlaybackState {
+    
+    /// The state as heard through an output that lags `latency` seconds
+    /// behind. Only a playing position lags. Once paused, the output catches
+    /// up to the reported position.
+    public func delayed(by latency: TimeInterval) -> PlaybackState {
+        guard latency != 0, case let .playing(start) = self else {
+            return self
+        }
+        return .playing(start: start.addingTimeInterval(latency))
+    }
+}
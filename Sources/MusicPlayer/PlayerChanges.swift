@@ -0,0 +1,134 @@
+//
+//  PlayerChanges.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// The parts of a player that changed, so that a subscriber can skip the
+/// work it doesn't need.
+public struct PlayerChanges: OptionSet, Hashable {
+    
+    public let rawValue: UInt16
+    
+    public init(rawValue: UInt16) {
+        self.rawValue = rawValue
+    }
+    
+    /// Another track. Every metadata field is set along with it.
+    public static let track         = PlayerChanges(rawValue: 1 << 0)
+    public static let title         = PlayerChanges(rawValue: 1 << 1)
+    public static let artist        = PlayerChanges(rawValue: 1 << 2)
+    public static let album         = PlayerChanges(rawValue: 1 << 3)
+    public static let duration      = PlayerChanges(rawValue: 1 << 4)
+    public static let artwork       = PlayerChanges(rawValue: 1 << 5)
+    public static let fileURL       = PlayerChanges(rawValue: 1 << 6)
+    /// Playing, paused, stopped, fast forwarding or rewinding.
+    public static let stateKind     = PlayerChanges(rawValue: 1 << 7)
+    /// A seek, or a position that drifted more than the tolerance.
+    public static let positionJump  = PlayerChanges(rawValue: 1 << 8)
+    
+    public static let metadata: PlayerChanges = [.title, .artist, .album, .duration, .artwork, .fileURL]
+    public static let playbackState: PlayerChanges = [.stateKind, .positionJump]
+    
+    /// Fields that differ between two versions of the same track. Only the
+    /// metadata `fields` are compared, so the others aren't decoded.
+    public init(metadataFrom old: MusicTrack?, to new: MusicTrack?, comparing fields: PlayerChanges = .metadata) {
+        guard let old = old, let new = new else {
+            self = old == nil && new == nil ? [] : fields.intersection(.metadata)
+            return
+        }
+        self = []
+        if fields.contains(.title), old.title != new.title { insert(.title) }
+        if fields.contains(.artist), old.artist != new.artist { insert(.artist) }
+        if fields.contains(.album), old.album != new.album { insert(.album) }
+        if fields.contains(.duration), old.duration != new.duration { insert(.duration) }
+        if fields.contains(.artwork), PlayerChanges.isArtworkDifferent(old.artwork, new.artwork) { insert(.artwork) }
+        if fields.contains(.fileURL), old.fileURL != new.fileURL { insert(.fileURL) }
+    }
+    
+    private static func isArtworkDifferent(_ old: Image?, _ new: Image?) -> Bool {
+        #if canImport(AppKit) || canImport(UIKit)
+        // Images are decoded anew on every update and compare by identity,
+        // so only artwork that arrives late or goes away counts.
+        return (old == nil) != (new == nil)
+        #else
+        return old != new
+        #endif
+    }
+    
+    public init(stateFrom old: PlaybackState, to new: PlaybackState, positionTolerance: TimeInterval = 1.5) {
+        self = []
+        // With an infinite tolerance, only the kinds are compared.
+        if !old.approximateEqual(to: new, tolerate: .infinity) {
+            insert(.stateKind)
+        } else if !old.approximateEqual(to: new, tolerate: positionTolerance) {
+            insert(.positionJump)
+        }
+    }
+    
+    /// Only what touches `fields` is compared. Without `.track` or a
+    /// metadata field, tracks aren't compared at all, so nothing of them is
+    /// decoded.
+    public init(from old: (track: MusicTrack?, state: PlaybackState), to new: (track: MusicTrack?, state: PlaybackState), policy: TrackIdentityPolicy = .backendID, comparing fields: PlayerChanges = .all) {
+        self = []
+        if !fields.isDisjoint(with: PlayerChanges.metadata.union(.track)) {
+            if old.track.isSameTrack(as: new.track, policy: policy) {
+                self = PlayerChanges(metadataFrom: old.track, to: new.track, comparing: fields)
+            } else {
+                self = [.track, .metadata]
+            }
+        }
+        if !fields.isDisjoint(with: .playbackState) {
+            formUnion(PlayerChanges(stateFrom: old.state, to: new.state))
+        }
+    }
+}
+
+/// A change of `currentTrack` or `playbackState`, with the new values.
+public struct PlayerChangeEvent {
+    
+    public var changes: PlayerChanges
+    public var track: MusicTrack?
+    public var playbackState: PlaybackState
+}
+
+private enum PlayerUpdate {
+    case track(MusicTrack?)
+    case state(PlaybackState)
+}
+
+extension MusicPlayerProtocol {
+    
+    /// Every change of `currentTrack` or `playbackState`, including new
+    /// metadata for the same track, tagged with what changed. A track
+    /// change and the state change that comes with it are two events.
+    /// Tracks are told apart by the player's `trackIdentityPolicy`.
+    public var changes: AnyPublisher<PlayerChangeEvent, Never> {
+        return changes(comparing: .all)
+    }
+    
+    /// `changes`, with only the fields in `fields` compared. Changes of the
+    /// others aren't reported.
+    func changes(comparing fields: PlayerChanges) -> AnyPublisher<PlayerChangeEvent, Never> {
+        let initial = PlayerChangeEvent(changes: [], track: currentTrack, playbackState: playbackState)
+        return Publishers.Merge(currentTrackWillChange.map(PlayerUpdate.track), playbackStateWillChange.map(PlayerUpdate.state))
+            .scan(initial) { [weak self] (last: PlayerChangeEvent, update: PlayerUpdate) -> PlayerChangeEvent in
+                var event = last
+                switch update {
+                case let .track(track): event.track = track
+                case let .state(state): event.playbackState = state
+                }
+                let policy = self?.trackIdentityPolicy ?? .backendID
+                event.changes = PlayerChanges(from: (last.track, last.playbackState), to: (event.track, event.playbackState), policy: policy, comparing: fields)
+                return event
+            }
+            .filter { !$0.changes.isEmpty }
+            .eraseToAnyPublisher()
+    }
+}
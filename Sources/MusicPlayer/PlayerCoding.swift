@@ -0,0 +1,532 @@
+//
+//  PlayerCoding.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+/// Objects a track refers to that can't be encoded, like `originalTrack`
+/// or an artwork image. Encoders store them here and write their index, and
+/// a decoder given the same table gets the same objects back. Without a
+/// table, they are left out.
+///
+/// Only meaningful within one process, like between a cache and its
+/// readers. Pass it to `Codable` coders in `userInfo[PlayerCodingReferences.userInfoKey]`.
+public final class PlayerCodingReferences {
+    
+    public static let userInfoKey = CodingUserInfoKey(rawValue: "ddddxxx.LyricsX.MusicPlayer.references")!
+    
+    /// Most objects kept. Beyond it, the oldest are dropped, and their
+    /// indices decode to nothing.
+    public let capacity: Int
+    
+    private let lock = NSLock()
+    private var objects: [AnyObject] = []
+    // Index of `objects.first`. Indices are never reused, so a dropped
+    // index can't decode to another object.
+    private var firstIndex = 0
+    private var indices: [ObjectIdentifier: Int] = [:]
+    
+    public init(capacity: Int = 256) {
+        self.capacity = max(1, capacity)
+    }
+    
+    public var count: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return objects.count
+    }
+    
+    /// Drops every object. Indices written before decode to nothing.
+    public func removeAll() {
+        lock.lock()
+        defer { lock.unlock() }
+        firstIndex += objects.count
+        objects.removeAll()
+        indices.removeAll()
+    }
+    
+    func index(of object: AnyObject) -> Int {
+        lock.lock()
+        defer { lock.unlock() }
+        // Stored objects are retained, so their identifiers aren't reused.
+        let id = ObjectIdentifier(object)
+        if let index = indices[id] {
+            return index
+        }
+        if objects.count == capacity {
+            indices[ObjectIdentifier(objects.removeFirst())] = nil
+            firstIndex += 1
+        }
+        let index = firstIndex + objects.count
+        objects.append(object)
+        indices[id] = index
+        return index
+    }
+    
+    func object(at index: Int) -> AnyObject? {
+        lock.lock()
+        defer { lock.unlock() }
+        let offset = index - firstIndex
+        return objects.indices.contains(offset) ? objects[offset] : nil
+    }
+}
+
+// MARK: - Codable
+
+extension PlaybackState: Codable {
+    
+    private enum CodingKeys: String, CodingKey {
+        case state
+        /// Position, except while playing.
+        case time
+        /// Seconds since 1970 when playback started. A `Date` would depend
+        /// on the coder's date strategy, which may round it.
+        case start
+    }
+    
+    public init(from decoder: Decoder) throws {
+        let container = try decoder.container(keyedBy: CodingKeys.self)
+        let state = try container.decode(String.self, forKey: .state)
+        switch state {
+        case "stopped":
+            self = .stopped
+        case "playing":
+            self = .playing(start: Date(timeIntervalSince1970: try container.decode(Double.self, forKey: .start)))
+        case "paused":
+            self = .paused(time: try container.decode(Double.self, forKey: .time))
+        case "fastForwarding":
+            self = .fastForwarding(time: try container.decode(Double.self, forKey: .time))
+        case "rewinding":
+            self = .rewinding(time: try container.decode(Double.self, forKey: .time))
+        default:
+            throw DecodingError.dataCorruptedError(forKey: .state, in: container, debugDescription: "Unknown playback state \(state)")
+        }
+    }
+    
+    public func encode(to encoder: Encoder) throws {
+        var container = encoder.container(keyedBy: CodingKeys.self)
+        switch self {
+        case .stopped:
+            try container.encode("stopped", forKey: .state)
+        case let .playing(start):
+            try container.encode("playing", forKey: .state)
+            try container.encode(start.timeIntervalSince1970, forKey: .start)
+        case let .paused(time):
+            try container.encode("paused", forKey: .state)
+            try container.encode(time, forKey: .time)
+        case let .fastForwarding(time):
+            try container.encode("fastForwarding", forKey: .state)
+            try container.encode(time, forKey: .time)
+        case let .rewinding(time):
+            try container.encode("rewinding", forKey: .state)
+            try container.encode(time, forKey: .time)
+        }
+    }
+}
+
+extension MusicTrack: Codable {
+    
+    private enum CodingKeys: String, CodingKey {
+        case id
+        case title
+        case album
+        case artist
+        case duration
+        case fileURL
+        case artworkURL
+        /// Indices in `PlayerCodingReferences`.
+        case artwork
+        case originalTrack
+    }
+    
+    public init(from decoder: Decoder) throws {
+        let container = try decoder.container(keyedBy: CodingKeys.self)
+        let references = decoder.userInfo[PlayerCodingReferences.userInfoKey] as? PlayerCodingReferences
+        var artwork = try container.decodeIfPresent(URL.self, forKey: .artworkURL) as Any as? Image
+        if artwork == nil, let index = try container.decodeIfPresent(Int.self, forKey: .artwork) {
+            artwork = references?.object(at: index) as? Image
+        }
+        let originalTrack = try container.decodeIfPresent(Int.self, forKey: .originalTrack).flatMap { references?.object(at: $0) }
+        self.init(id: try container.decode(String.self, forKey: .id),
+                  title: try container.decodeIfPresent(String.self, forKey: .title),
+                  album: try container.decodeIfPresent(String.self, forKey: .album),
+                  artist: try container.decodeIfPresent(String.self, forKey: .artist),
+                  duration: try container.decodeIfPresent(TimeInterval.self, forKey: .duration),
+                  fileURL: try container.decodeIfPresent(URL.self, forKey: .fileURL),
+                  artwork: artwork,
+                  originalTrack: originalTrack)
+    }
+    
+    public func encode(to encoder: Encoder) throws {
+        var container = encoder.container(keyedBy: CodingKeys.self)
+        let references = encoder.userInfo[PlayerCodingReferences.userInfoKey] as? PlayerCodingReferences
+        try container.encode(id, forKey: .id)
+        try container.encodeIfPresent(title, forKey: .title)
+        try container.encodeIfPresent(album, forKey: .album)
+        try container.encodeIfPresent(artist, forKey: .artist)
+        try container.encodeIfPresent(duration, forKey: .duration)
+        try container.encodeIfPresent(fileURL, forKey: .fileURL)
+        if let url = artwork as Any as? URL {
+            try container.encode(url, forKey: .artworkURL)
+        } else if let artwork = artwork, let references = references {
+            try container.encode(references.index(of: artwork as AnyObject), forKey: .artwork)
+        }
+        if let originalTrack = originalTrack, let references = references {
+            try container.encode(references.index(of: originalTrack), forKey: .originalTrack)
+        }
+    }
+}
+
+// MARK: - Binary
+
+// A track is a presence byte, then a byte of `BinaryTrackField` flags, the
+// id, and each field that is set, in flag order. Strings are a LEB128 length
+// and UTF-8 bytes, numbers are little-endian IEEE 754 doubles, and references
+// are LEB128 indices. A state is a kind byte and, unless stopped, a double:
+// seconds since 1970 when playback started if playing, the position if not.
+
+private struct BinaryTrackField: OptionSet {
+    
+    let rawValue: UInt8
+    
+    static let title            = BinaryTrackField(rawValue: 1 << 0)
+    static let album            = BinaryTrackField(rawValue: 1 << 1)
+    static let artist           = BinaryTrackField(rawValue: 1 << 2)
+    static let duration         = BinaryTrackField(rawValue: 1 << 3)
+    static let fileURL          = BinaryTrackField(rawValue: 1 << 4)
+    static let artworkURL       = BinaryTrackField(rawValue: 1 << 5)
+    static let artwork          = BinaryTrackField(rawValue: 1 << 6)
+    static let originalTrack    = BinaryTrackField(rawValue: 1 << 7)
+}
+
+/// Writes tracks and playback states in a compact, versioned binary format,
+/// for IPC and caches. `musicplayer-bench` compares it with JSON.
+public struct PlayerBinaryEncoder {
+    
+    /// Written by `encodeVersion()`. Readers reject other versions.
+    public static let version: UInt8 = 1
+    
+    public var references: PlayerCodingReferences?
+    
+    public private(set) var bytes: [UInt8] = []
+    
+    public init(references: PlayerCodingReferences? = nil) {
+        self.references = references
+    }
+    
+    /// Starts a document, like a file or a message.
+    public mutating func encodeVersion() {
+        write(PlayerBinaryEncoder.version)
+    }
+    
+    public mutating func encode(_ track: MusicTrack?) {
+        guard let track = track else {
+            write(0 as UInt8)
+            return
+        }
+        write(1 as UInt8)
+        let title = track.title
+        let album = track.album
+        let artist = track.artist
+        let duration = track.duration
+        let fileURL = track.fileURL?.absoluteString
+        let artwork = track.artwork
+        let artworkURL = (artwork as Any as? URL)?.absoluteString
+        let artworkIndex = artworkURL == nil ? artwork.flatMap { references?.index(of: $0 as AnyObject) } : nil
+        let originalTrackIndex = track.originalTrack.flatMap { references?.index(of: $0) }
+        
+        var fields: BinaryTrackField = []
+        if title != nil { fields.insert(.title) }
+        if album != nil { fields.insert(.album) }
+        if artist != nil { fields.insert(.artist) }
+        if duration != nil { fields.insert(.duration) }
+        if fileURL != nil { fields.insert(.fileURL) }
+        if artworkURL != nil { fields.insert(.artworkURL) }
+        if artworkIndex != nil { fields.insert(.artwork) }
+        if originalTrackIndex != nil { fields.insert(.originalTrack) }
+        write(fields.rawValue)
+        
+        write(track.id)
+        title.map { write($0) }
+        album.map { write($0) }
+        artist.map { write($0) }
+        duration.map { write($0) }
+        fileURL.map { write($0) }
+        artworkURL.map { write($0) }
+        artworkIndex.map { write(varint: UInt64($0)) }
+        originalTrackIndex.map { write(varint: UInt64($0)) }
+    }
+    
+    public mutating func encode(_ state: PlaybackState) {
+        switch state {
+        case .stopped:
+            write(0 as UInt8)
+        case let .playing(start):
+            write(1 as UInt8)
+            write(start.timeIntervalSince1970)
+        case let .paused(time):
+            write(2 as UInt8)
+            write(time)
+        case let .fastForwarding(time):
+            write(3 as UInt8)
+            write(time)
+        case let .rewinding(time):
+            write(4 as UInt8)
+            write(time)
+        }
+    }
+    
+    // MARK: Primitives
+    
+    mutating func write(_ value: UInt8) {
+        bytes.append(value)
+    }
+    
+    mutating func write(varint value: UInt64) {
+        var value = value
+        while value >= 0x80 {
+            bytes.append(UInt8(truncatingIfNeeded: value) | 0x80)
+            value >>= 7
+        }
+        bytes.append(UInt8(value))
+    }
+    
+    mutating func write(_ value: Double) {
+        withUnsafeBytes(of: value.bitPattern.littleEndian) { bytes.append(contentsOf: $0) }
+    }
+    
+    mutating func write(_ value: String) {
+        var value = value
+        value.withUTF8 { utf8 in
+            write(varint: UInt64(utf8.count))
+            bytes.append(contentsOf: utf8)
+        }
+    }
+    
+    mutating func write(_ value: String?) {
+        if let value = value {
+            write(1 as UInt8)
+            write(value)
+        } else {
+            write(0 as UInt8)
+        }
+    }
+}
+
+/// Reads what `PlayerBinaryEncoder` writes. Malformed input reads as `nil`.
+///
+/// Only the id of a track is decoded right away. Its other strings stay in
+/// the buffer, which the track keeps, until they are read.
+public struct PlayerBinaryDecoder {
+    
+    public var references: PlayerCodingReferences?
+    
+    private let bytes: ArraySlice<UInt8>
+    private var offset: Int
+    
+    public init(_ bytes: ArraySlice<UInt8>, references: PlayerCodingReferences? = nil) {
+        self.bytes = bytes
+        self.offset = bytes.startIndex
+        self.references = references
+    }
+    
+    public init(_ bytes: [UInt8], references: PlayerCodingReferences? = nil) {
+        self.init(bytes[...], references: references)
+    }
+    
+    public var isAtEnd: Bool {
+        return offset == bytes.endIndex
+    }
+    
+    /// Whether the document was written with this version of the format.
+    public mutating func decodeVersion() -> Bool {
+        return readByte() == PlayerBinaryEncoder.version
+    }
+    
+    /// Outer `nil` means malformed input, inner `nil` no track.
+    public mutating func decodeTrack() -> MusicTrack?? {
+        switch readByte() {
+        case 0?:
+            return .some(nil)
+        case 1?:
+            break
+        default:
+            return nil
+        }
+        guard let rawFields = readByte(), let id = readString() else {
+            return nil
+        }
+        let fields = BinaryTrackField(rawValue: rawFields)
+        let source = BinaryTrackFieldSource(bytes: bytes)
+        if fields.contains(.title) {
+            guard let range = readStringRange() else { return nil }
+            source.titleRange = range
+        }
+        if fields.contains(.album) {
+            guard let range = readStringRange() else { return nil }
+            source.albumRange = range
+        }
+        if fields.contains(.artist) {
+            guard let range = readStringRange() else { return nil }
+            source.artistRange = range
+        }
+        if fields.contains(.duration) {
+            guard let duration = readDouble() else { return nil }
+            source.duration = duration
+        }
+        if fields.contains(.fileURL) {
+            guard let range = readStringRange() else { return nil }
+            source.fileURLRange = range
+        }
+        if fields.contains(.artworkURL) {
+            guard let range = readStringRange() else { return nil }
+            source.artworkURLRange = range
+        }
+        if fields.contains(.artwork) {
+            guard let index = readVarint() else { return nil }
+            source.artworkObject = references?.object(at: Int(truncatingIfNeeded: index))
+        }
+        var originalTrack: AnyObject?
+        if fields.contains(.originalTrack) {
+            guard let index = readVarint() else { return nil }
+            originalTrack = references?.object(at: Int(truncatingIfNeeded: index))
+        }
+        return .some(MusicTrack(id: id, fieldSource: source, originalTrack: originalTrack))
+    }
+    
+    public mutating func decodeState() -> PlaybackState? {
+        guard let kind = readByte() else {
+            return nil
+        }
+        guard kind != 0 else {
+            return .stopped
+        }
+        guard let time = readDouble() else {
+            return nil
+        }
+        switch kind {
+        case 1:     return .playing(start: Date(timeIntervalSince1970: time))
+        case 2:     return .paused(time: time)
+        case 3:     return .fastForwarding(time: time)
+        case 4:     return .rewinding(time: time)
+        default:    return nil
+        }
+    }
+    
+    // MARK: Primitives
+    
+    mutating func readByte() -> UInt8? {
+        guard offset < bytes.endIndex else { return nil }
+        defer { offset += 1 }
+        return bytes[offset]
+    }
+    
+    mutating func readVarint() -> UInt64? {
+        var value: UInt64 = 0
+        var shift: UInt64 = 0
+        while shift < 64, let byte = readByte() {
+            value |= UInt64(byte & 0x7F) << shift
+            if byte & 0x80 == 0 {
+                return value
+            }
+            shift += 7
+        }
+        return nil
+    }
+    
+    mutating func readDouble() -> Double? {
+        guard bytes.endIndex - offset >= 8 else { return nil }
+        var value: UInt64 = 0
+        for i in 0..<8 {
+            value |= UInt64(bytes[offset + i]) << (8 * UInt64(i))
+        }
+        offset += 8
+        return Double(bitPattern: value)
+    }
+    
+    /// Where the next string is, without copying it.
+    mutating func readStringRange() -> Range<Int>? {
+        guard let count = readVarint(), count <= UInt64(bytes.endIndex - offset) else { return nil }
+        defer { offset += Int(count) }
+        return offset..<offset + Int(count)
+    }
+    
+    mutating func readString() -> String? {
+        return readStringRange().map { String(decoding: bytes[$0], as: UTF8.self) }
+    }
+    
+    /// Outer `nil` means malformed input, inner `nil` an absent value.
+    mutating func readOptionalString() -> String?? {
+        switch readByte() {
+        case 0?: return .some(nil)
+        case 1?:
+            guard let value = readString() else { return nil }
+            return .some(value)
+        default: return nil
+        }
+    }
+}
+
+/// Strings of a decoded track, still in the encoded buffer.
+private final class BinaryTrackFieldSource: MusicTrackFieldSource {
+    
+    private let bytes: ArraySlice<UInt8>
+    
+    // Set while decoding.
+    var titleRange: Range<Int>?
+    var albumRange: Range<Int>?
+    var artistRange: Range<Int>?
+    var duration: TimeInterval?
+    var fileURLRange: Range<Int>?
+    var artworkURLRange: Range<Int>?
+    var artworkObject: AnyObject?
+    
+    private let lock = NSLock()
+    private var cache: [Int: String] = [:]
+    
+    init(bytes: ArraySlice<UInt8>) {
+        self.bytes = bytes
+    }
+    
+    var title: String? {
+        return string(in: titleRange)
+    }
+    
+    var album: String? {
+        return string(in: albumRange)
+    }
+    
+    var artist: String? {
+        return string(in: artistRange)
+    }
+    
+    var fileURL: URL? {
+        return string(in: fileURLRange).flatMap(URL.init(string:))
+    }
+    
+    var artwork: Image? {
+        if let object = artworkObject {
+            return object as? Image
+        }
+        return string(in: artworkURLRange).flatMap(URL.init(string:)) as Any as? Image
+    }
+    
+    private func string(in range: Range<Int>?) -> String? {
+        guard let range = range else {
+            return nil
+        }
+        lock.lock()
+        defer { lock.unlock() }
+        if let string = cache[range.lowerBound] {
+            return string
+        }
+        let string = String(decoding: bytes[range], as: UTF8.self)
+        cache[range.lowerBound] = string
+        return string
+    }
+}
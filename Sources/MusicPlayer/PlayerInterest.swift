@@ -0,0 +1,145 @@
+//
+//  PlayerInterest.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+extension PlayerChanges {
+    
+    public static let all: PlayerChanges = [.track, .metadata, .playbackState]
+}
+
+/// A player that can follow fewer fields while its subscribers read fewer.
+///
+/// Interest is a `PlayerChanges` set: `[.track]` for a scrobbler that only
+/// needs to know when the track changes, `[.stateKind]` for a play/pause
+/// button. A player follows the union of what is registered, and fields
+/// outside of it may go stale.
+public protocol PlayerInterestTracking: AnyObject {
+    
+    /// Keeps `interest` followed until the returned canceller is cancelled
+    /// or released.
+    func registerInterest(_ interest: PlayerChanges) -> AnyCancellable
+}
+
+extension MusicPlayerProtocol {
+    
+    /// `changes` that touch `interest`. A player that tracks interest
+    /// follows it for as long as the subscription lasts, and can drop the
+    /// signals and skip decoding the fields that no one asked for.
+    public func changes(of interest: PlayerChanges) -> AnyPublisher<PlayerChangeEvent, Never> {
+        let tracking = self as? PlayerInterestTracking
+        return Deferred { () -> AnyPublisher<PlayerChangeEvent, Never> in
+            let registration = tracking?.registerInterest(interest)
+            // Only the fields of interest are compared, so the others are
+            // never decoded.
+            return self.changes(comparing: interest)
+                .filter { !$0.changes.isDisjoint(with: interest) }
+                .handleEvents(receiveCancel: { registration?.cancel() })
+                .eraseToAnyPublisher()
+        }
+        .eraseToAnyPublisher()
+    }
+}
+
+/// Counts registered interest field by field.
+final class PlayerInterestRegistry {
+    
+    private var counts = [Int](repeating: 0, count: PlayerChanges.RawValue.bitWidth)
+    private var _union: PlayerChanges = []
+    private let lock = NSLock()
+    
+    /// Every field registered at least once.
+    var union: PlayerChanges {
+        lock.lock()
+        defer { lock.unlock() }
+        return _union
+    }
+    
+    /// Called when `union` widens or narrows, on the thread that registered
+    /// or cancelled.
+    var unionDidChange: (() -> Void)?
+    
+    func register(_ interest: PlayerChanges) -> AnyCancellable {
+        update(interest, by: 1)
+        return AnyCancellable { [weak self] in
+            self?.update(interest, by: -1)
+        }
+    }
+    
+    private func update(_ interest: PlayerChanges, by delta: Int) {
+        lock.lock()
+        var union: PlayerChanges = []
+        for bit in counts.indices {
+            let field = PlayerChanges(rawValue: 1 << bit)
+            if interest.contains(field) {
+                counts[bit] += delta
+            }
+            if counts[bit] > 0 {
+                union.insert(field)
+            }
+        }
+        let changed = union != _union
+        _union = union
+        lock.unlock()
+        if changed {
+            unionDidChange?()
+        }
+    }
+}
+
+/// Registers the interest registered with an agent with its designated
+/// player, and moves it along when another player is designated.
+final class PlayerInterestForwarder {
+    
+    let registry = PlayerInterestRegistry()
+    
+    private weak var target: PlayerInterestTracking?
+    private var registration: AnyCancellable?
+    private var generation = 0
+    private let lock = NSLock()
+    
+    init() {
+        registry.unionDidChange = { [unowned self] in
+            self.update()
+        }
+    }
+    
+    func forward(to player: MusicPlayerProtocol?) {
+        lock.lock()
+        target = player as? PlayerInterestTracking
+        lock.unlock()
+        update()
+    }
+    
+    private func update() {
+        lock.lock()
+        generation += 1
+        let generation = self.generation
+        let target = self.target
+        lock.unlock()
+        // Registered outside the lock, since the player may publish right
+        // away, to subscribers that register with the agent again. And
+        // before the old one is cancelled, so that the player doesn't narrow
+        // and widen again in between.
+        let union = registry.union
+        let registration = union.isEmpty ? nil : target?.registerInterest(union)
+        lock.lock()
+        // A later update registers what is current by now.
+        guard generation == self.generation else {
+            lock.unlock()
+            registration?.cancel()
+            return
+        }
+        let old = self.registration
+        self.registration = registration
+        lock.unlock()
+        old?.cancel()
+    }
+}
@@ -7,8 +7,6 @@
 //  file, You can obtain one at https://mozilla.org/MPL/2.0/.
 //
 
-#if false // TODO: PlaybackModeSettable
-
 public enum RepeatMode: CaseIterable {
     case off
     case one
@@ -39,5 +37,3 @@ public extension PlaybackModeSettable {
         return ShuffleMode.allCases
     }
 }
-
-#endif
@@ -0,0 +1,242 @@
+//
+//  PlayerSelection.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// Decides which player `MusicPlayers.NowPlaying` follows.
+///
+/// Playing players are preferred over paused ones, and stopped players are
+/// never chosen. Within each group, players are ordered by `priority`, then
+/// by the time they were last active if `prefersLastActive`, then by their
+/// order in `players`.
+///
+/// The default policy is the rule used before policies existed: the
+/// designated player is kept while it's playing, then the first playing
+/// player is chosen, then the first running one, switching immediately.
+public struct PlayerSelectionPolicy {
+    
+    /// Player identifiers, most preferred first. An entry also matches the
+    /// instances of a player, so `"firefox"` matches `"firefox.instance42"`.
+    /// Unlisted players rank after listed ones.
+    public var priority: [String]
+    
+    /// Player identifiers that are never chosen. Matched like `priority`.
+    public var denied: [String]
+    
+    /// Prefer the player that started playing most recently, or among
+    /// paused players, the one that stopped playing most recently.
+    /// Otherwise the order of `players` breaks ties.
+    public var prefersLastActive: Bool
+    
+    /// How long another player has to stay the better choice before it
+    /// replaces the current one. Short overlaps, such as a notification
+    /// sound, or a player pausing between tracks, don't cause a switch.
+    public var switchDelay: TimeInterval
+    
+    /// Keep the designated player while it's playing, even if another
+    /// player becomes the better choice.
+    public var keepsPlayingPlayer: Bool
+    
+    public init(priority: [String] = [], denied: [String] = [], prefersLastActive: Bool = false, switchDelay: TimeInterval = 0, keepsPlayingPlayer: Bool = true) {
+        self.priority = priority
+        self.denied = denied
+        self.prefersLastActive = prefersLastActive
+        self.switchDelay = switchDelay
+        self.keepsPlayingPlayer = keepsPlayingPlayer
+    }
+    
+    public static let `default` = PlayerSelectionPolicy()
+    
+    /// Same as `default`, the rule used before policies existed.
+    public static let firstActive = PlayerSelectionPolicy()
+    
+    /// Follows the player that started playing most recently, once it kept
+    /// playing for 2 seconds.
+    public static let lastActive = PlayerSelectionPolicy(prefersLastActive: true, switchDelay: 2, keepsPlayingPlayer: false)
+    
+    func isDenied(_ identifier: String) -> Bool {
+        return denied.contains { isPlayerIdentifier(identifier, matching: $0) }
+    }
+    
+    func rank(of identifier: String) -> Int {
+        return priority.firstIndex { isPlayerIdentifier(identifier, matching: $0) } ?? priority.count
+    }
+}
+
+/// An agent that chooses among players, like `MusicPlayers.NowPlaying`.
+public protocol PlayerSelecting: AnyObject {
+    
+    /// Never chooses players matching `identifier`, as if it was in
+    /// `PlayerSelectionPolicy.denied`, until the returned canceller is
+    /// cancelled or released. `selectionPolicy` is left as it was set.
+    func excludePlayers(matching identifier: String) -> AnyCancellable
+}
+
+/// How often `MusicPlayers.NowPlaying` switched players, to tune a
+/// `PlayerSelectionPolicy`.
+public struct PlayerSelectionStatistics {
+    
+    /// Number of times the players were re-evaluated.
+    public internal(set) var evaluations = 0
+    
+    /// Number of times the designated player changed.
+    public internal(set) var switches = 0
+    
+    /// Number of switches that `switchDelay` prevented, because the other
+    /// player stopped being the better choice in time.
+    public internal(set) var suppressedSwitches = 0
+    
+    /// Number of switches back to the previously designated player.
+    public internal(set) var reverts = 0
+    
+    /// Shortest time a player stayed designated.
+    public internal(set) var shortestTenure: TimeInterval?
+    
+    /// Total time of all ended tenures.
+    public internal(set) var totalTenure: TimeInterval = 0
+    
+    var endedTenures = 0
+    
+    public var averageTenure: TimeInterval? {
+        return endedTenures > 0 ? totalTenure / TimeInterval(endedTenures) : nil
+    }
+    
+    public init() {}
+}
+
+/// Selection state of a `PlayerSelectionLoop`, updated on every evaluation.
+struct PlayerSelector {
+    
+    private struct Activity {
+        var playingSince: TimeInterval?
+        var lastActive: TimeInterval = -.infinity
+    }
+    
+    var policy: PlayerSelectionPolicy
+    
+    private(set) var statistics = PlayerSelectionStatistics()
+    
+    private var activities: [ObjectIdentifier: Activity] = [:]
+    private var challenger: (player: ObjectIdentifier?, since: TimeInterval)?
+    private var previous: ObjectIdentifier?
+    private var designatedSince: TimeInterval?
+    
+    init(policy: PlayerSelectionPolicy) {
+        self.policy = policy
+    }
+    
+    /// The player to designate, or `current` if it should be kept for now.
+    /// If a switch is pending, `recheckAfter` is the time until it's due.
+    ///
+    /// Generic over `AnyObject` rather than `MusicPlayerProtocol`, so that
+    /// existentials can be passed too, and specialized for typed players.
+    mutating func select<Player: AnyObject>(from players: [Player], current: Player?, at now: TimeInterval, state: (Player) -> PlaybackState, identifier: (Player) -> String) -> (player: Player?, recheckAfter: TimeInterval?) {
+        statistics.evaluations += 1
+        updateActivities(players, at: now, state: state)
+        
+        let isCurrentCandidate = current.map { current in
+            players.contains { $0 === current } && !policy.isDenied(identifier(current))
+        } ?? false
+        let keepsCurrent = policy.keepsPlayingPlayer && isCurrentCandidate && state(current!).isPlaying
+        let best = keepsCurrent ? current : bestPlayer(in: players, state: state, identifier: identifier)
+        let bestID = best.map { ObjectIdentifier($0) }
+        let currentID = current.map { ObjectIdentifier($0) }
+        guard bestID != currentID else {
+            if challenger != nil {
+                challenger = nil
+                statistics.suppressedSwitches += 1
+            }
+            return (current, nil)
+        }
+        
+        // A player that went away or was denied is replaced right away.
+        if !isCurrentCandidate || policy.switchDelay <= 0 {
+            return (didSwitch(to: best, from: currentID, at: now), nil)
+        }
+        
+        if let challenger = challenger, challenger.player == bestID {
+            let elapsed = now - challenger.since
+            if elapsed >= policy.switchDelay {
+                return (didSwitch(to: best, from: currentID, at: now), nil)
+            }
+            return (current, policy.switchDelay - elapsed)
+        }
+        if challenger != nil {
+            statistics.suppressedSwitches += 1
+        }
+        challenger = (bestID, now)
+        return (current, policy.switchDelay)
+    }
+    
+    mutating func resetStatistics() {
+        statistics = PlayerSelectionStatistics()
+    }
+    
+    private mutating func didSwitch<Player: AnyObject>(to player: Player?, from currentID: ObjectIdentifier?, at now: TimeInterval) -> Player? {
+        let id = player.map { ObjectIdentifier($0) }
+        challenger = nil
+        statistics.switches += 1
+        if id != nil && id == previous {
+            statistics.reverts += 1
+        }
+        if let since = designatedSince {
+            let tenure = now - since
+            statistics.totalTenure += tenure
+            statistics.endedTenures += 1
+            statistics.shortestTenure = min(statistics.shortestTenure ?? tenure, tenure)
+        }
+        previous = currentID
+        designatedSince = now
+        return player
+    }
+    
+    private mutating func updateActivities<Player: AnyObject>(_ players: [Player], at now: TimeInterval, state: (Player) -> PlaybackState) {
+        var newActivities: [ObjectIdentifier: Activity] = [:]
+        newActivities.reserveCapacity(players.count)
+        for player in players {
+            let id = ObjectIdentifier(player)
+            var activity = activities[id] ?? Activity()
+            if state(player).isPlaying {
+                activity.playingSince = activity.playingSince ?? now
+                activity.lastActive = now
+            } else if activity.playingSince != nil {
+                activity.playingSince = nil
+                activity.lastActive = now
+            }
+            newActivities[id] = activity
+        }
+        activities = newActivities
+    }
+    
+    private func bestPlayer<Player: AnyObject>(in players: [Player], state: (Player) -> PlaybackState, identifier: (Player) -> String) -> Player? {
+        var best: (player: Player, key: (Int, Int, TimeInterval))?
+        for player in players {
+            let playbackState = state(player)
+            guard playbackState != .stopped, !policy.isDenied(identifier(player)) else {
+                continue
+            }
+            let activity = activities[ObjectIdentifier(player)]
+            let recency: TimeInterval
+            if !policy.prefersLastActive {
+                recency = 0
+            } else if playbackState.isPlaying {
+                recency = activity?.playingSince ?? -.infinity
+            } else {
+                recency = activity?.lastActive ?? -.infinity
+            }
+            // Smaller is better. Ties keep the earlier player.
+            let key = (playbackState.isPlaying ? 0 : 1, policy.rank(of: identifier(player)), -recency)
+            if best == nil || key < best!.key {
+                best = (player, key)
+            }
+        }
+        return best?.player
+    }
+}
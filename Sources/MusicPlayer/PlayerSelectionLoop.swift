@@ -0,0 +1,282 @@
+//
+//  PlayerSelectionLoop.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// The selection of `MusicPlayers.NowPlaying` and `TypedNowPlaying`.
+///
+/// Observes all players, not only the designated one, so that the policy
+/// knows when each of them was last active, and re-evaluates on
+/// `playerUpdate` on every change and when a delayed switch is due.
+///
+/// Players publish on their own queues, so their properties are never read
+/// here. Each player's track and state are copied as they're published,
+/// and selection only reads these snapshots.
+final class PlayerSelectionLoop<Player: AnyObject> {
+    
+    /// The designated player of the owner.
+    var current: () -> Player? = { nil }
+    
+    /// Designates a newly selected player.
+    var designate: (Player?) -> Void = { _ in }
+    
+    /// Called after every evaluation.
+    var didEvaluate: () -> Void = {}
+    
+    /// The policy as it was set, without exclusions.
+    var policy: PlayerSelectionPolicy {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return basePolicy
+        }
+        set {
+            lock.lock()
+            basePolicy = newValue
+            updatePolicy()
+            lock.unlock()
+            select()
+        }
+    }
+    
+    /// `policy` with the excluded players denied, which is what selection
+    /// uses.
+    var effectivePolicy: PlayerSelectionPolicy {
+        lock.lock()
+        defer { lock.unlock() }
+        return selector.policy
+    }
+    
+    var statistics: PlayerSelectionStatistics {
+        lock.lock()
+        defer { lock.unlock() }
+        return selector.statistics
+    }
+    
+    /// The players, each with its last snapshot.
+    var playerSnapshots: [(player: Player, snapshot: PlayerSnapshot)] {
+        lock.lock()
+        defer { lock.unlock() }
+        snapshotLock.lock()
+        defer { snapshotLock.unlock() }
+        return players.compactMap { player in
+            snapshots[ObjectIdentifier(player)].map { (player, $0) }
+        }
+    }
+    
+    private var selector: PlayerSelector
+    private var basePolicy: PlayerSelectionPolicy
+    private var exclusions: [Int: String] = [:]
+    private var nextExclusion = 0
+    private var players: [Player] = []
+    private var snapshots: [ObjectIdentifier: PlayerSnapshot] = [:]
+    // Never held while calling out, unlike `lock`, so that players can
+    // always store their snapshots.
+    private let snapshotLock = NSLock()
+    private var isHeld: Bool
+    private var pendingSelection: DispatchWorkItem?
+    private var subscriptions: [ObjectIdentifier: AnyCancellable] = [:]
+    // Incremented by every evaluation. Only the latest one designates.
+    private var evaluation = 0
+    // Held while designating, instead of `lock`, so that subscribers of the
+    // designated player can read the loop. Recursive, since they may also
+    // set the policy.
+    private let designationLock = NSRecursiveLock()
+    // Selection runs on `playerUpdate`, and also wherever players or the
+    // policy are set. Never held while calling out.
+    private let lock = NSLock()
+    
+    private let identifier: (Player) -> String
+    private let changes: (Player) -> AnyPublisher<PlayerSnapshot, Never>
+    
+    /// While `isHeld`, nothing is selected, until players are set.
+    /// `changes` must send the current snapshot on subscription, like
+    /// `MusicPlayerProtocol.snapshots`.
+    init(policy: PlayerSelectionPolicy, isHeld: Bool = false, identifier: @escaping (Player) -> String, changes: @escaping (Player) -> AnyPublisher<PlayerSnapshot, Never>) {
+        self.selector = PlayerSelector(policy: policy)
+        self.basePolicy = policy
+        self.isHeld = isHeld
+        self.identifier = identifier
+        self.changes = changes
+    }
+    
+    deinit {
+        pendingSelection?.cancel()
+    }
+    
+    /// Observes `players` instead of the previous ones, and selects. Players
+    /// that were already observed keep their subscription and snapshot.
+    func setPlayers(_ players: [Player], releasingHold: Bool = true) {
+        lock.lock()
+        self.players = players
+        if releasingHold {
+            isHeld = false
+        }
+        var subscriptions: [ObjectIdentifier: AnyCancellable] = [:]
+        var newPlayers: [Player] = []
+        for player in players {
+            let id = ObjectIdentifier(player)
+            if let subscription = self.subscriptions.removeValue(forKey: id) {
+                subscriptions[id] = subscription
+            } else {
+                newPlayers.append(player)
+            }
+        }
+        let removed = self.subscriptions
+        self.subscriptions = subscriptions
+        lock.unlock()
+        removed.values.forEach { $0.cancel() }
+        snapshotLock.lock()
+        for id in removed.keys {
+            snapshots[id] = nil
+        }
+        snapshotLock.unlock()
+        // The current snapshots are stored on subscription.
+        for player in newPlayers {
+            let subscription = subscribe(to: player)
+            lock.lock()
+            // Unless the player was removed again meanwhile.
+            if self.players.contains(where: { $0 === player }) {
+                self.subscriptions[ObjectIdentifier(player)] = subscription
+            } else {
+                subscription.cancel()
+            }
+            lock.unlock()
+        }
+        select()
+    }
+    
+    private func subscribe(to player: Player) -> AnyCancellable {
+        let id = ObjectIdentifier(player)
+        return changes(player)
+            .map { [weak self] (snapshot: PlayerSnapshot) -> UInt64? in
+                self?.store(snapshot, for: id)
+                return EventTracer.current
+            }
+            .receive(on: DispatchQueue.playerUpdate.cx)
+            .sink { [weak self] trace in
+                EventTracer.shared.mark(.hop, trace: trace)
+                EventTracer.withCurrent(trace) {
+                    self?.select()
+                }
+            }
+    }
+    
+    /// Denies players matching `identifier` until the returned canceller is
+    /// cancelled or released, without changing `policy`.
+    func exclude(_ identifier: String) -> AnyCancellable {
+        lock.lock()
+        let token = nextExclusion
+        nextExclusion += 1
+        exclusions[token] = identifier
+        updatePolicy()
+        lock.unlock()
+        select()
+        return AnyCancellable { [weak self] in
+            self?.removeExclusion(token)
+        }
+    }
+    
+    private func removeExclusion(_ token: Int) {
+        lock.lock()
+        let isRemoved = exclusions.removeValue(forKey: token) != nil
+        if isRemoved {
+            updatePolicy()
+        }
+        lock.unlock()
+        if isRemoved {
+            select()
+        }
+    }
+    
+    /// Called with `lock` held. The caller selects after unlocking.
+    private func updatePolicy() {
+        var policy = basePolicy
+        policy.denied += exclusions.sorted { $0.key < $1.key }.map { $0.value }
+        selector.policy = policy
+    }
+    
+    func resetStatistics() {
+        lock.lock()
+        defer { lock.unlock() }
+        selector.resetStatistics()
+    }
+    
+    private func store(_ snapshot: PlayerSnapshot, for id: ObjectIdentifier) {
+        snapshotLock.lock()
+        snapshots[id] = snapshot
+        snapshotLock.unlock()
+    }
+    
+    private func select() {
+        let current = self.current()
+        lock.lock()
+        pendingSelection?.cancel()
+        pendingSelection = nil
+        guard !isHeld else {
+            lock.unlock()
+            return
+        }
+        evaluation += 1
+        let evaluation = self.evaluation
+        snapshotLock.lock()
+        let snapshots = self.snapshots
+        snapshotLock.unlock()
+        let selection = selector.select(from: players, current: current, at: ProcessInfo.processInfo.systemUptime, state: { player in
+            snapshots[ObjectIdentifier(player)]?.state ?? .stopped
+        }, identifier: identifier)
+        EventTracer.shared.mark(.select, trace: EventTracer.current)
+        // Nothing may change before a delayed switch is due.
+        if let delay = selection.recheckAfter {
+            let item = DispatchWorkItem { [weak self] in
+                self?.select()
+            }
+            pendingSelection = item
+            DispatchQueue.playerUpdate.asyncAfter(deadline: .now() + delay, execute: item)
+        }
+        lock.unlock()
+        
+        designationLock.lock()
+        if isLatest(evaluation) && selection.player !== self.current() {
+            designate(selection.player)
+        }
+        designationLock.unlock()
+        didEvaluate()
+    }
+    
+    private func isLatest(_ evaluation: Int) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return evaluation == self.evaluation
+    }
+}
+
+/// A copy of a player's track and state, taken as the player publishes
+/// them, on the player's own queue.
+struct PlayerSnapshot {
+    var track: MusicTrack?
+    var state: PlaybackState
+}
+
+extension MusicPlayerProtocol {
+    
+    /// Snapshots of the player, starting with the current one, sent when
+    /// the track or the state changes. Starts from the current values, for
+    /// players whose publishers only send changes.
+    var snapshots: AnyPublisher<PlayerSnapshot, Never> {
+        return Deferred {
+            Publishers.CombineLatest(
+                self.currentTrackWillChange.prepend(self.currentTrack),
+                self.playbackStateWillChange.prepend(self.playbackState))
+        }
+        .map { track, state in PlayerSnapshot(track: track, state: state) }
+        .eraseToAnyPublisher()
+    }
+}
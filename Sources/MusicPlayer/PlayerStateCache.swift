@@ -0,0 +1,197 @@
+//
+//  PlayerStateCache.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+/// A small file with the last known state of the players of a
+/// `NowPlaying`, so that the next process has something to show before its
+/// players are found.
+///
+/// Saves are rate limited, and written off the caller's queue.
+public final class PlayerStateCache {
+    
+    public struct Snapshot {
+        
+        public struct Player {
+            public var identifier: String
+            public var track: MusicTrack?
+            public var playbackState: PlaybackState
+            
+            public init(identifier: String, track: MusicTrack?, playbackState: PlaybackState) {
+                self.identifier = identifier
+                self.track = track
+                self.playbackState = playbackState
+            }
+        }
+        
+        public var players: [Player]
+        public var designatedIdentifier: String?
+        public var savedAt: Date
+        
+        public init(players: [Player], designatedIdentifier: String?, savedAt: Date = Date()) {
+            self.players = players
+            self.designatedIdentifier = designatedIdentifier
+            self.savedAt = savedAt
+        }
+    }
+    
+    /// `MusicPlayer/state` in the user's cache directory.
+    public static var defaultURL: URL {
+        let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first
+            ?? URL(fileURLWithPath: NSTemporaryDirectory())
+        return caches.appendingPathComponent("MusicPlayer", isDirectory: true).appendingPathComponent("state")
+    }
+    
+    public let url: URL
+    
+    /// Shortest time between two writes.
+    public let minimumInterval: TimeInterval
+    
+    private let queue = DispatchQueue(label: "ddddxxx.LyricsX.MusicPlayer.StateCache")
+    private let lock = NSLock()
+    private var isSavePending = false
+    private var lastSave = -TimeInterval.infinity
+    
+    public init(url: URL = PlayerStateCache.defaultURL, minimumInterval: TimeInterval = 2) {
+        self.url = url
+        self.minimumInterval = minimumInterval
+    }
+    
+    /// The last saved snapshot, or `nil` if there is none or it can't be
+    /// read.
+    public func load() -> Snapshot? {
+        guard let data = try? Data(contentsOf: url) else {
+            return nil
+        }
+        return Snapshot(binaryRepresentation: [UInt8](data))
+    }
+    
+    /// Writes `snapshot` now, on the calling thread.
+    public func save(_ snapshot: Snapshot) {
+        let data = Data(snapshot.binaryRepresentation)
+        try? FileManager.default.createDirectory(at: url.deletingLastPathComponent(), withIntermediateDirectories: true)
+        try? data.write(to: url, options: .atomic)
+    }
+    
+    /// Saves the snapshot made by `makeSnapshot` once `minimumInterval` has
+    /// passed since the last write. Calls in between are coalesced, and
+    /// `makeSnapshot` runs on the player update queue right before writing.
+    public func setNeedsSave(_ makeSnapshot: @escaping () -> Snapshot?) {
+        lock.lock()
+        defer { lock.unlock() }
+        guard !isSavePending else {
+            return
+        }
+        isSavePending = true
+        // A short delay also lets the change that triggered this land.
+        let delay = max(0.1, lastSave + minimumInterval - ProcessInfo.processInfo.systemUptime)
+        DispatchQueue.playerUpdate.asyncAfter(deadline: .now() + delay) { [weak self] in
+            let snapshot = makeSnapshot()
+            self?.queue.async {
+                guard let self = self else { return }
+                self.lock.lock()
+                self.isSavePending = false
+                self.lastSave = ProcessInfo.processInfo.systemUptime
+                self.lock.unlock()
+                snapshot.map(self.save)
+            }
+        }
+    }
+}
+
+extension PlayerStateCache.Snapshot {
+    
+    /// The designated player of the snapshot, or else the first one that was
+    /// not stopped. A state that was playing so long ago that the track must
+    /// have ended is shown as paused where it was saved.
+    func provisionalPlayer(at now: Date = Date()) -> MusicPlayers.Provisional? {
+        let designated = players.first { $0.identifier == designatedIdentifier }
+            ?? players.first { $0.playbackState != .stopped }
+        guard let player = designated else {
+            return nil
+        }
+        var state = player.playbackState
+        if case let .playing(start) = state {
+            let elapsed = now.timeIntervalSince(start)
+            let duration = player.track?.duration ?? 0
+            if elapsed > (duration > 0 ? duration : 60) {
+                state = .paused(time: savedAt.timeIntervalSince(start))
+            }
+        }
+        return MusicPlayers.Provisional(identifier: player.identifier, track: player.track, state: state)
+    }
+}
+
+extension PlayerStateCache.Snapshot {
+    
+    /// Whether `other` has the same designated player, and the same players
+    /// with the same tracks and states, as far as `PlayerChanges` can tell.
+    /// When either was saved doesn't matter.
+    func hasSameState(as other: PlayerStateCache.Snapshot) -> Bool {
+        guard designatedIdentifier == other.designatedIdentifier, players.count == other.players.count else {
+            return false
+        }
+        return zip(players, other.players).allSatisfy { mine, theirs in
+            mine.identifier == theirs.identifier
+                && PlayerChanges(from: (mine.track, mine.playbackState), to: (theirs.track, theirs.playbackState)).isEmpty
+        }
+    }
+}
+
+// MARK: - Storage
+
+// A magic number, then a `PlayerBinaryEncoder` document: the save date, the
+// designated identifier, and the number of players, each an identifier, a
+// track and a state.
+
+extension PlayerStateCache.Snapshot {
+    
+    private static let magic: [UInt8] = Array("LXPS".utf8)
+    
+    var binaryRepresentation: [UInt8] {
+        var encoder = PlayerBinaryEncoder()
+        PlayerStateCache.Snapshot.magic.forEach { encoder.write($0) }
+        encoder.encodeVersion()
+        encoder.write(savedAt.timeIntervalSince1970)
+        encoder.write(designatedIdentifier)
+        encoder.write(varint: UInt64(players.count))
+        for player in players {
+            encoder.write(player.identifier)
+            encoder.encode(player.track)
+            encoder.encode(player.playbackState)
+        }
+        return encoder.bytes
+    }
+    
+    /// Fails on files of other versions, which are then overwritten by the
+    /// next save.
+    init?(binaryRepresentation bytes: [UInt8]) {
+        let magic = PlayerStateCache.Snapshot.magic
+        guard bytes.starts(with: magic) else {
+            return nil
+        }
+        var decoder = PlayerBinaryDecoder(bytes[magic.count...])
+        guard decoder.decodeVersion(),
+            let savedAt = decoder.readDouble(),
+            let designated = decoder.readOptionalString(),
+            let count = decoder.readVarint() else {
+            return nil
+        }
+        var players: [Player] = []
+        for _ in 0..<count {
+            guard let identifier = decoder.readString(),
+                let track = decoder.decodeTrack(),
+                let state = decoder.decodeState() else {
+                return nil
+            }
+            players.append(Player(identifier: identifier, track: track, playbackState: state))
+        }
+        self.init(players: players, designatedIdentifier: designated, savedAt: Date(timeIntervalSince1970: savedAt))
+    }
+}
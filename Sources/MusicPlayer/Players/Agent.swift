@@ -20,12 +20,32 @@ extension MusicPlayers {
         public let objectWillChange = ObservableObjectPublisher()
         
         private var objectWillChangeCanceller: AnyCancellable?
+        private var interestCanceller: AnyCancellable?
+        private let interestForwarder = PlayerInterestForwarder()
+        private var positionTickers: [Double: PositionTicker] = [:]
+        private let positionTickersLock = NSLock()
         
         public init() {
             objectWillChangeCanceller = $designatedPlayer
                 .map { $0?.objectWillChange.eraseToAnyPublisher() ?? Just(()).eraseToAnyPublisher() }
                 .switchToLatest()
                 .sink { [weak self] _ in self?.objectWillChange.send() }
+            interestCanceller = $designatedPlayer
+                .sink { [weak self] in self?.interestForwarder.forward(to: $0) }
+        }
+        
+        /// Extrapolated positions of the designated player, `rate` times per
+        /// second while it plays. Subscribers at the same rate share one
+        /// timer, which stops while paused, stopped or unobserved.
+        public func positionTicks(rate: Double = 30) -> AnyPublisher<TimeInterval, Never> {
+            positionTickersLock.lock()
+            defer { positionTickersLock.unlock() }
+            if let ticker = positionTickers[rate] {
+                return ticker.positions
+            }
+            let ticker = PositionTicker(player: self, rate: rate)
+            positionTickers[rate] = ticker
+            return ticker.positions
         }
     }
 }
@@ -36,6 +56,10 @@ extension MusicPlayers.Agent: MusicPlayerProtocol {
         return designatedPlayer?.name
     }
     
+    public var playerIdentifier: String {
+        return designatedPlayer?.playerIdentifier ?? ""
+    }
+    
     public var currentTrack: MusicTrack? {
         return designatedPlayer?.currentTrack
     }
@@ -44,6 +68,10 @@ extension MusicPlayers.Agent: MusicPlayerProtocol {
         return designatedPlayer?.playbackState ?? .stopped
     }
     
+    public var trackIdentityPolicy: TrackIdentityPolicy {
+        return designatedPlayer?.trackIdentityPolicy ?? .backendID
+    }
+    
     public var playbackTime: TimeInterval {
         get { return designatedPlayer?.playbackTime ?? 0 }
         set { designatedPlayer?.playbackTime = newValue }
@@ -84,4 +112,21 @@ extension MusicPlayers.Agent: MusicPlayerProtocol {
     public func updatePlayerState() {
         designatedPlayer?.updatePlayerState()
     }
+    
+    /// In the context of the designated player.
+    public func performInContext(_ body: @escaping () -> Void) {
+        if let player = designatedPlayer {
+            player.performInContext(body)
+        } else {
+            body()
+        }
+    }
+}
+
+extension MusicPlayers.Agent: PlayerInterestTracking {
+    
+    /// Registered with the designated player, whichever it is.
+    public func registerInterest(_ interest: PlayerChanges) -> AnyCancellable {
+        return interestForwarder.registry.register(interest)
+    }
 }
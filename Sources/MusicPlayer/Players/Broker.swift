@@ -0,0 +1,146 @@
+//
+//  Broker.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+extension MusicPlayers {
+    
+    /// Mirrors a player served by a `NowPlayingBroker` in another process.
+    public final class Broker: ObservableObject {
+        
+        public static var defaultPath: String {
+            return BrokerSocket.defaultPath
+        }
+        
+        public let path: String
+        
+        @Published public private(set) var currentTrack: MusicTrack?
+        @Published public private(set) var playbackState: PlaybackState = .stopped
+        @Published public private(set) var isConnected = true
+        
+        private let fd: Int32
+        // Reads, writes and the connection state are serialized here, so
+        // that commands sent from several threads don't interleave frames.
+        private let queue: DispatchQueue
+        private let readSource: DispatchSourceRead
+        private var parser = BrokerFrameParser()
+        private var readBuffer = [UInt8](repeating: 0, count: 4096)
+        
+        public init?(path: String = Broker.defaultPath) {
+            guard let fd = BrokerSocket.makeConnection(path: path) else {
+                return nil
+            }
+            self.path = path
+            self.fd = fd
+            let queue = DispatchQueue.player("Broker")
+            self.queue = queue
+            readSource = DispatchSource.makeReadSource(fileDescriptor: fd, queue: queue)
+            readSource.setEventHandler { [weak self] in
+                self?.readAvailable()
+            }
+            readSource.setCancelHandler {
+                close(fd)
+            }
+            readSource.resume()
+        }
+        
+        deinit {
+            readSource.cancel()
+        }
+        
+        private func readAvailable() {
+            guard let count = BrokerSocket.read(fd, into: &readBuffer),
+                let messages = parser.consume(readBuffer[0..<count]) else {
+                disconnect()
+                return
+            }
+            for message in messages {
+                switch message {
+                case let .track(track):
+                    currentTrack = track
+                case let .state(state):
+                    playbackState = state
+                case .command:
+                    break
+                }
+            }
+        }
+        
+        private func disconnect() {
+            guard isConnected else {
+                return
+            }
+            readSource.cancel()
+            isConnected = false
+            currentTrack = nil
+            playbackState = .stopped
+        }
+        
+        private func send(_ command: BrokerCommand) {
+            let frame = BrokerMessage.command(command).frame
+            queue.async { [weak self] in
+                guard let self = self, self.isConnected else {
+                    return
+                }
+                if frame.withUnsafeBytes({ BrokerSocket.write(self.fd, $0) }) == nil {
+                    self.disconnect()
+                }
+            }
+        }
+    }
+}
+
+extension MusicPlayers.Broker: MusicPlayerProtocol {
+    
+    public var currentTrackWillChange: AnyPublisher<MusicTrack?, Never> {
+        return $currentTrack.eraseToAnyPublisher()
+    }
+    
+    public var playbackStateWillChange: AnyPublisher<PlaybackState, Never> {
+        return $playbackState.eraseToAnyPublisher()
+    }
+    
+    public var name: MusicPlayerName? {
+        return nil
+    }
+    
+    public var playbackTime: TimeInterval {
+        get {
+            return playbackState.time
+        }
+        set {
+            send(.seek(newValue))
+        }
+    }
+    
+    public func resume() {
+        send(.resume)
+    }
+    
+    public func pause() {
+        send(.pause)
+    }
+    
+    public func playPause() {
+        send(.playPause)
+    }
+    
+    public func skipToNextItem() {
+        send(.skipToNextItem)
+    }
+    
+    public func skipToPreviousItem() {
+        send(.skipToPreviousItem)
+    }
+    
+    public func updatePlayerState() {
+        send(.updatePlayerState)
+    }
+}
@@ -24,16 +24,149 @@ extension MusicPlayers {
     
     public final class MPRIS: ObservableObject {
         
-        let player: UnsafeMutablePointer<PlayerctlPlayer>
+        /// Nil for players found by `MPRISNowPlaying(buses:)`, whose signals
+        /// come straight from the bus.
+        let player: UnsafeMutablePointer<PlayerctlPlayer>?
         
         public let playerName: String
         
+        /// The bus the player was found on.
+        public let bus: MPRISBus
+        
+        /// The instance name, followed by `@` and the bus if that isn't the
+        /// session bus, like `mpd@system`.
+        public let playerIdentifier: String
+        
+        /// Reads go straight to the bus, with a timeout, instead of through
+        /// playerctl, which waits up to 25 s for a frozen player.
+        private let connection: OpaquePointer? /* GDBusConnection* */
+        private let busName: String
+        
         public var name: MusicPlayerName? = MusicPlayerName.mpris
         
         @Published public private(set) var currentTrack: MusicTrack?
         @Published public private(set) var playbackState: PlaybackState = .stopped
         
+        /// Playback state as the player last reported it, before
+        /// `OutputLatency`.
+        private var reportedPlaybackState: PlaybackState = .stopped
+        
+        /// Set while the player doesn't answer in time. Its state is then
+        /// left as it was, and it's only probed now and then until it answers
+        /// again.
+        @Published public private(set) var isDegraded = false
+        
         private var signals: [gulong] = []
+        private var subscriptions: [guint] = []
+        private var blockedSignals = Set<gulong>()
+        private var seekedSubscription: guint = 0
+        /// The unique name of a player followed without playerctl.
+        private var owner: String?
+        
+        /// Followed even without subscribers of `changes(of:)`. Everything
+        /// by default, as `currentTrack` and `playbackState` can be read at
+        /// any time. Narrow it when every consumer subscribes with an
+        /// interest. The playback status is always followed.
+        public var baselineInterest: PlayerChanges = .all {
+            didSet {
+                updateInterest()
+            }
+        }
+        
+        /// `baselineInterest` and the interest of every subscriber. Seek
+        /// signals are only handled for `.positionJump`, and metadata is
+        /// only read and compared for `.track` and the metadata fields that
+        /// are in it. `currentTrack` goes stale without either.
+        ///
+        /// Players found by `MPRISNowPlaying(buses:)` remove the `Seeked`
+        /// match rule while seeks aren't of interest. Through playerctl, its
+        /// proxy stays subscribed to `Seeked` and `PropertiesChanged`, so the
+        /// messages still arrive, and only the handlers and the reads behind
+        /// them are skipped.
+        public private(set) var interest: PlayerChanges = .all
+        
+        private let interests = PlayerInterestRegistry()
+        
+        /// Decides when the track has changed. MPRIS players often report a
+        /// placeholder track id. Use `.content` for one that makes up a new
+        /// id on every play.
+        public var trackIdentityPolicy: TrackIdentityPolicy = .automatic
+        
+        /// Polling fallback, used only if this player drops or delays signals.
+        public var pollingPolicy: PollingPolicy {
+            get { return signalHealth.policy }
+            set { signalHealth.policy = newValue }
+        }
+        
+        public var isPolling: Bool {
+            return signalHealth.needsPolling
+        }
+        
+        /// Bounds every read from the player.
+        public var callPolicy: CallTimeoutPolicy {
+            get { return breaker.policy }
+            set { breaker.policy = newValue }
+        }
+        
+        private var signalHealth = SignalHealthMonitor(policy: .default)
+        private var breaker = CircuitBreaker(policy: .default)
+        private var probeTimeout: GTimeout?
+        private var isProbing = false
+        private var pollTimeout: GTimeout?
+        private var trackEndTimeout: GTimeout?
+        private var signalCheckTimeouts: [GTimeout] = []
+        private var latencyCanceller: AnyCancellable?
+        
+        /// Set by `MPRISNowPlaying` while this endpoint shows the same media
+        /// as another one. Signals are then only passed to
+        /// `suspendedSignalHandler`, and nothing is read or published.
+        var isSuspended = false {
+            didSet {
+                guard isSuspended != oldValue else {
+                    return
+                }
+                if isSuspended {
+                    pollTimeout = nil
+                    trackEndTimeout = nil
+                    signalCheckTimeouts = []
+                } else if !isDetaching {
+                    refresh(.explicit)
+                }
+            }
+        }
+        
+        /// Set by `MPRISNowPlaying` while no player has played for a while.
+        /// Seek and metadata signals are then dropped, nothing is read, and
+        /// only a playback status signal that reports playing gets through,
+        /// to `wakeHandler`.
+        var isIdle = false {
+            didSet {
+                guard isIdle != oldValue else {
+                    return
+                }
+                updateSignals()
+                if isIdle {
+                    pollTimeout = nil
+                    trackEndTimeout = nil
+                    signalCheckTimeouts = []
+                } else if !isDetaching {
+                    refresh(.explicit)
+                }
+            }
+        }
+        
+        /// Signals, polls and reads so far.
+        public private(set) var wakeups = WakeupCounters()
+        
+        /// Called after every refresh, with whether anything was published.
+        var refreshHandler: ((Bool) -> Void)?
+        
+        var suspendedSignalHandler: ((SignalHealthMonitor.Trigger) -> Void)?
+        
+        var wakeHandler: (() -> Void)?
+        
+        /// Set while `detach()` clears what `MPRISNowPlaying` set.
+        private var isDetaching = false
         
         public convenience init?(name: String) {
             guard let player = playerctl_player_new(name, nil) else {
@@ -42,29 +175,40 @@ extension MusicPlayers {
             self.init(player: player, name: name)
         }
         
-        init(player: UnsafeMutablePointer<PlayerctlPlayer>, name: String) {
-            self.player = player
-            self.playerName = name
+        convenience init(player: UnsafeMutablePointer<PlayerctlPlayer>, name: String) {
+            let isSystemBus = gproperty(player, name: "source") { value in
+                UInt32(g_value_get_enum(value)) == PLAYERCTL_SOURCE_DBUS_SYSTEM.rawValue
+            }
+            let instance: String = gproperty(player, name: "player-instance") { value in
+                defer { g_value_unset(value) }
+                return g_value_get_string(value).map { String(cString: $0) } ?? name
+            }
+            self.init(player: player,
+                      connection: g_bus_get_sync(isSystemBus ? G_BUS_TYPE_SYSTEM : G_BUS_TYPE_SESSION, nil, nil),
+                      bus: isSystemBus ? .system : .session,
+                      instance: instance,
+                      name: name)
             
             let onPlayStatusChanged: @convention(c) (UnsafeMutablePointer<PlayerctlPlayer>?,
                                                      gint /* PlayerctlPlaybackStatus */,
                                                      UnsafeMutableRawPointer?) -> Void
                 = { player, status, data in
-                    data?.unretainedCast(to: MPRIS.self).updatePlayerState()
+                    let isPlaying = UInt32(status) == PLAYERCTL_PLAYBACK_STATUS_PLAYING.rawValue
+                    data?.unretainedCast(to: MPRIS.self).playbackStatusDidChange(isPlaying: isPlaying)
                 }
             
             let onSeeked: @convention(c) (UnsafeMutablePointer<PlayerctlPlayer>?,
                                           gint64,
                                           UnsafeMutableRawPointer?) -> Void
                 = { player, position, data in
-                    data?.unretainedCast(to: MPRIS.self).updatePlayerState()
+                    data?.unretainedCast(to: MPRIS.self).refresh(.seekedSignal)
                 }
             
             let onMetadataChanged: @convention(c) (UnsafeMutablePointer<PlayerctlPlayer>?,
                                                    OpaquePointer? /* GVariant* */,
                                                    UnsafeMutableRawPointer?) -> Void
                 = { player, metadata, data in
-                    data?.unretainedCast(to: MPRIS.self).updatePlayerState()
+                    data?.unretainedCast(to: MPRIS.self).refresh(.metadataSignal)
                 }
             
             let pself = Unmanaged.passUnretained(self).toOpaque()
@@ -78,20 +222,92 @@ extension MusicPlayers {
             signals.append(
                 g_signal_connect_data(player, "metadata", unsafeBitCast(onMetadataChanged, to: GCallback?.self), pself, nil, G_CONNECT_AFTER)
             )
-            updatePlayerState()
+            refresh(.initial)
+        }
+        
+        /// Follows the player that `owner`, a unique name, runs on a bus
+        /// connection shared with other players.
+        convenience init(connection: OpaquePointer /* GDBusConnection* */, bus: MPRISBus, instance: String, owner: String) {
+            self.init(player: nil, connection: OpaquePointer(g_object_ref(UnsafeMutableRawPointer(connection))),
+                      bus: bus, instance: instance, name: instance)
+            self.owner = owner
+            
+            let onPropertiesChanged: @convention(c) (OpaquePointer?, UnsafePointer<gchar>?, UnsafePointer<gchar>?,
+                                                     UnsafePointer<gchar>?, UnsafePointer<gchar>?,
+                                                     OpaquePointer? /* GVariant* */, gpointer?) -> Void
+                = { _, _, _, _, _, parameters, data in
+                    let changed = g_variant_get_child_value(parameters, 1)!
+                    data?.unretainedCast(to: MPRIS.self).propertiesDidChange(changed)
+                    g_variant_unref(changed)
+                }
+            
+            // Subscribed by unique name, as signals of a well-known name
+            // would also reach the other players on this connection.
+            let pself = Unmanaged.passUnretained(self).toOpaque()
+            subscriptions.append(
+                g_dbus_connection_signal_subscribe(connection, owner, Self.propertiesInterface, "PropertiesChanged", Self.objectPath,
+                                                   Self.playerInterface, G_DBUS_SIGNAL_FLAGS_NONE, onPropertiesChanged, pself, nil)
+            )
+            updateSignals()
+            refresh(.initial)
+        }
+        
+        /// Takes over the reference to `connection`.
+        private init(player: UnsafeMutablePointer<PlayerctlPlayer>?, connection: OpaquePointer?, bus: MPRISBus, instance: String, name: String) {
+            self.player = player
+            self.playerName = name
+            self.bus = bus
+            self.playerIdentifier = MPRIS.identifier(name: name, bus: bus)
+            self.connection = connection
+            self.busName = MPRIS.busNamePrefix + instance
+            
+            // Both are called on arbitrary threads. The registry and the
+            // state are only read on the GLib main loop, where all other
+            // updates happen.
+            interests.unionDidChange = { [weak self] in
+                gMainContextInvoke {
+                    self?.updateInterest()
+                }
+            }
+            latencyCanceller = outputLatencyDidChange.sink { [weak self] in
+                // The last reported state is compensated again, without
+                // asking the player.
+                gMainContextInvoke {
+                    guard let self = self, !self.isSuspended else {
+                        return
+                    }
+                    let state = self.reportedPlaybackState.delayed(by: self.outputLatency)
+                    if state != self.playbackState {
+                        self.playbackState = state
+                    }
+                }
+            }
         }
         
         deinit {
-            for var signal in signals {
-                g_clear_signal_handler(&signal, player)
+            if let connection = connection {
+                subscriptions.forEach { g_dbus_connection_signal_unsubscribe(connection, $0) }
+                if seekedSubscription != 0 {
+                    g_dbus_connection_signal_unsubscribe(connection, seekedSubscription)
+                }
+                g_object_unref(UnsafeMutableRawPointer(connection))
+            }
+            if let player = player {
+                for var signal in signals {
+                    g_clear_signal_handler(&signal, player)
+                }
+                g_object_unref(player)
             }
-            g_object_unref(player)
         }
     }
 }
 
 extension MusicPlayers.MPRIS {
     
+    static func identifier(name: String, bus: MPRISBus) -> String {
+        return bus == .session ? name : "\(name)@\(bus)"
+    }
+    
     public class var names: [String] {
         let playerNames = playerctl_list_players(nil)
         var result: [String] = []
@@ -117,81 +333,497 @@ extension MusicPlayers.MPRIS: MusicPlayerProtocol {
         $playbackState.eraseToAnyPublisher()
     }
     
+    /// Extrapolated from the last state, which is compensated for
+    /// `OutputLatency` while playing. Never waits for the player. Use
+    /// `readPlaybackTime(_:)` to ask it.
+    ///
+    /// Set on the GLib main loop, without waiting for the player.
     public var playbackTime: TimeInterval {
         get {
-            Double(playerctl_player_get_position(player, nil)) / 1_000_000
+            return playbackState.time
         }
         set {
-            playerctl_player_set_position(player, Int(newValue * 1_000_000), nil)
+            gMainContextInvoke { [weak self] in
+                guard let self = self, !self.breaker.isOpen else {
+                    return
+                }
+                self.setPosition(self.playbackState.isPlaying ? newValue + self.outputLatency : newValue)
+            }
+        }
+    }
+    
+    /// Asks the player for its position on the GLib main loop, and calls
+    /// `completion` there with it, compensated for `OutputLatency` while
+    /// playing. Gets the extrapolated `playbackTime` while the player is
+    /// degraded or doesn't answer.
+    public func readPlaybackTime(_ completion: @escaping (TimeInterval) -> Void) {
+        gMainContextInvoke { [weak self] in
+            guard let self = self else {
+                return
+            }
+            guard let position = self.readPosition() else {
+                completion(self.playbackTime)
+                return
+            }
+            completion(self.playbackState.isPlaying ? max(0, position - self.outputLatency) : position)
         }
     }
     
+    // Commands are sent without waiting for the reply, so a frozen player
+    // can't block the caller.
+    
     public func resume() {
-        playerctl_player_play(player, nil)
+        send("Play")
     }
     
     public func pause() {
-        playerctl_player_pause(player, nil)
+        send("Pause")
     }
     
     public func playPause() {
-        playerctl_player_play_pause(player, nil)
+        send("PlayPause")
     }
     
     public func skipToNextItem() {
-        playerctl_player_next(player, nil)
+        send("Next")
     }
     
     public func skipToPreviousItem() {
-        playerctl_player_previous(player, nil)
+        send("Previous")
     }
     
     public func updatePlayerState() {
-        let state = self.state
-        let track = self.track
-        if currentTrack?.id != track?.id {
-            currentTrack = track
-            playbackState = state
-        } else if !playbackState.approximateEqual(to: state) {
-            playbackState = state
+        refresh(.explicit)
+    }
+    
+    /// On the GLib main loop.
+    public func performInContext(_ body: @escaping () -> Void) {
+        gMainContextInvoke(body)
+    }
+}
+
+// MARK: - D-Bus
+
+extension MusicPlayers.MPRIS {
+    
+    private static let busNamePrefix = "org.mpris.MediaPlayer2."
+    private static let objectPath = "/org/mpris/MediaPlayer2"
+    private static let playerInterface = "org.mpris.MediaPlayer2.Player"
+    private static let propertiesInterface = "org.freedesktop.DBus.Properties"
+    
+    private var timeoutMilliseconds: gint {
+        return gint(max(1, (callPolicy.timeout * 1000).rounded(.up)))
+    }
+    
+    /// State and track in a single call. The state is not compensated for
+    /// `OutputLatency`. Only the track id is decoded here. Everything else is
+    /// decoded from the metadata when a consumer reads it. The metadata
+    /// isn't looked at unless the track is of interest.
+    private func readProperties() -> (state: PlaybackState, track: MusicTrack?)? {
+        let parameters: [OpaquePointer?] = [g_variant_new_string(Self.playerInterface)]
+        guard let reply = call(Self.propertiesInterface, "GetAll", parameters) else {
+            return nil
+        }
+        defer { g_variant_unref(reply) }
+        let properties = g_variant_get_child_value(reply, 0)!
+        defer { g_variant_unref(properties) }
+        
+        let position = lookup("Position", in: properties, G_VARIANT_CLASS_INT64) { value in
+            Double(g_variant_get_int64(value)) / 1_000_000
+        } ?? 0
+        let status = lookup("PlaybackStatus", in: properties, G_VARIANT_CLASS_STRING) { value in
+            String(cString: g_variant_get_string(value, nil))
+        }
+        let state: PlaybackState
+        switch status {
+        case "Playing": state = .playing(time: position)
+        case "Paused":  state = .paused(time: position)
+        default:        state = .stopped
+        }
+        
+        guard followsTrack else {
+            return (state, currentTrack)
+        }
+        let variant = g_variant_lookup_value(properties, "Metadata", nil)
+        return (state, variant.map(MPRISMetadata.init(variant:)).flatMap(MusicTrack.init(mprisMetadata:)))
+    }
+    
+    private func readPosition() -> TimeInterval? {
+        guard !breaker.isOpen else {
+            return nil
+        }
+        let parameters: [OpaquePointer?] = [g_variant_new_string(Self.playerInterface), g_variant_new_string("Position")]
+        guard let reply = call(Self.propertiesInterface, "Get", parameters) else {
+            return nil
+        }
+        defer { g_variant_unref(reply) }
+        let boxed = g_variant_get_child_value(reply, 0)!
+        defer { g_variant_unref(boxed) }
+        let value = g_variant_get_variant(boxed)!
+        defer { g_variant_unref(value) }
+        guard g_variant_classify(value) == G_VARIANT_CLASS_INT64 else {
+            return nil
+        }
+        return Double(g_variant_get_int64(value)) / 1_000_000
+    }
+    
+    private func lookup<T>(_ key: String, in dictionary: OpaquePointer, _ type: GVariantClass, transform: (OpaquePointer) -> T) -> T? {
+        guard let value = g_variant_lookup_value(dictionary, key, nil) else {
+            return nil
+        }
+        defer { g_variant_unref(value) }
+        return g_variant_classify(value) == type ? transform(value) : nil
+    }
+    
+    /// Waits at most `callPolicy.timeout` for the reply, which the caller
+    /// owns. Consumes the floating parameters.
+    private func call(_ interface: String, _ method: String, _ parameters: [OpaquePointer?]) -> OpaquePointer? {
+        guard let connection = connection else {
+            return nil
+        }
+        wakeups.calls += 1
+        var error: UnsafeMutablePointer<GError>?
+        let reply = g_dbus_connection_call_sync(connection, busName, Self.objectPath, interface, method,
+                                                g_variant_new_tuple(parameters, gsize(parameters.count)), nil,
+                                                G_DBUS_CALL_FLAGS_NO_AUTO_START, timeoutMilliseconds, nil, &error)
+        guard error == nil else {
+            let timedOut = g_error_matches(error, g_io_error_quark(), gint(G_IO_ERROR_TIMED_OUT.rawValue)) != 0
+            g_clear_error(&error)
+            if timedOut {
+                wakeups.timeouts += 1
+            }
+            if timedOut, breaker.recordTimeout() {
+                degrade()
+            }
+            return nil
+        }
+        breaker.recordSuccess()
+        return reply
+    }
+    
+    private func send(_ method: String, _ parameters: [OpaquePointer?] = []) {
+        guard let connection = connection else {
+            return
+        }
+        let tuple = parameters.isEmpty ? nil : g_variant_new_tuple(parameters, gsize(parameters.count))
+        g_dbus_connection_call(connection, busName, Self.objectPath, Self.playerInterface, method, tuple, nil,
+                               G_DBUS_CALL_FLAGS_NO_AUTO_START, timeoutMilliseconds, nil, nil, nil)
+    }
+    
+    /// `SetPosition` is ignored unless it names the current track.
+    private func setPosition(_ position: TimeInterval) {
+        guard let id = currentTrack?.id, g_variant_is_object_path(id) != 0 else {
+            return
+        }
+        send("SetPosition", [g_variant_new_object_path(id), g_variant_new_int64(gint64(position * 1_000_000))])
+    }
+    
+    /// Handles `PropertiesChanged` of a player followed without playerctl.
+    /// A status change that comes with new metadata is read as one.
+    private func propertiesDidChange(_ changed: OpaquePointer /* GVariant* */) {
+        let status = lookup("PlaybackStatus", in: changed, G_VARIANT_CLASS_STRING) { value in
+            String(cString: g_variant_get_string(value, nil))
+        }
+        let hasMetadata = followsTrack && lookup("Metadata", in: changed, G_VARIANT_CLASS_ARRAY) { _ in true } ?? false
+        if let status = status, isIdle || !hasMetadata {
+            playbackStatusDidChange(isPlaying: status == "Playing")
+        } else if hasMetadata, !isIdle {
+            refresh(.metadataSignal)
+        }
+    }
+}
+
+// MARK: - Interest
+
+extension MusicPlayers.MPRIS: PlayerInterestTracking {
+    
+    public func registerInterest(_ interest: PlayerChanges) -> AnyCancellable {
+        return interests.register(interest)
+    }
+    
+    private var followsTrack: Bool {
+        return !interest.isDisjoint(with: PlayerChanges.metadata.union(.track))
+    }
+    
+    private var followsSeeks: Bool {
+        return interest.contains(.positionJump)
+    }
+    
+    private func updateInterest() {
+        let newInterest = baselineInterest.union(interests.union)
+        guard newInterest != interest else {
+            return
+        }
+        let isWider = !newInterest.isSubset(of: interest)
+        interest = newInterest
+        updateSignals()
+        // What wasn't followed until now may be stale.
+        if isWider && !isDetaching {
+            refresh(.explicit)
+        }
+    }
+    
+    /// Connects the seek and metadata signals only while they are of
+    /// interest and the player isn't idle. The playback status is always
+    /// connected, to select and wake players.
+    private func updateSignals() {
+        if let player = player {
+            // The handlers of `seeked` and `metadata`.
+            for (signal, isWanted) in zip(signals.dropFirst(), [followsSeeks, followsTrack]) {
+                let isBlocked = blockedSignals.contains(signal)
+                if isBlocked && (isWanted && !isIdle) {
+                    g_signal_handler_unblock(player, signal)
+                    blockedSignals.remove(signal)
+                } else if !isBlocked && (!isWanted || isIdle) {
+                    g_signal_handler_block(player, signal)
+                    blockedSignals.insert(signal)
+                }
+            }
+        }
+        // Metadata comes with `PropertiesChanged`, which also carries the
+        // status, and is dropped as it comes in.
+        guard let connection = connection, let owner = owner else {
+            return
+        }
+        let wantsSeeked = followsSeeks && !isIdle
+        if wantsSeeked && seekedSubscription == 0 {
+            let onSeeked: @convention(c) (OpaquePointer?, UnsafePointer<gchar>?, UnsafePointer<gchar>?,
+                                          UnsafePointer<gchar>?, UnsafePointer<gchar>?,
+                                          OpaquePointer? /* GVariant* */, gpointer?) -> Void
+                = { _, _, _, _, _, _, data in
+                    data!.unretainedCast(to: MusicPlayers.MPRIS.self).refresh(.seekedSignal)
+                }
+            seekedSubscription = g_dbus_connection_signal_subscribe(connection, owner, Self.playerInterface, "Seeked", Self.objectPath, nil,
+                                                                    G_DBUS_SIGNAL_FLAGS_NONE, onSeeked,
+                                                                    Unmanaged.passUnretained(self).toOpaque(), nil)
+        } else if !wantsSeeked && seekedSubscription != 0 {
+            g_dbus_connection_signal_unsubscribe(connection, seekedSubscription)
+            seekedSubscription = 0
+        }
+    }
+}
+
+// MARK: - Circuit Breaker
+
+extension MusicPlayers.MPRIS {
+    
+    private func degrade() {
+        isDegraded = true
+        pollTimeout = nil
+        trackEndTimeout = nil
+        signalCheckTimeouts = []
+        scheduleProbe()
+    }
+    
+    private func scheduleProbe() {
+        probeTimeout = GTimeout(after: breaker.probeInterval) { [unowned self] in
+            self.probe()
         }
     }
     
-    private var state: PlaybackState {
-        gproperty(player, name: "playback-status") { val in
-            switch PlayerctlPlaybackStatus(UInt32(g_value_get_enum(val))) {
-            case PLAYERCTL_PLAYBACK_STATUS_PLAYING:
-                return .playing(time: playbackTime)
-            case PLAYERCTL_PLAYBACK_STATUS_PAUSED:
-                return .paused(time: playbackTime)
-            case PLAYERCTL_PLAYBACK_STATUS_STOPPED:
-                return .stopped
-            default:
-                return .stopped
+    /// Asks for the playback status without blocking. The reply, or the
+    /// timeout, comes back on the GLib main loop.
+    private func probe() {
+        guard let connection = connection, !isProbing else {
+            return
+        }
+        isProbing = true
+        probeTimeout = nil
+        wakeups.calls += 1
+        let onReply: @convention(c) (UnsafeMutablePointer<GObject>?, OpaquePointer?, gpointer?) -> Void = { _, result, data in
+            let mpris = Unmanaged<MusicPlayers.MPRIS>.fromOpaque(data!).takeRetainedValue()
+            var error: UnsafeMutablePointer<GError>?
+            let reply = g_dbus_connection_call_finish(mpris.connection, result, &error)
+            g_clear_error(&error)
+            if let reply = reply {
+                g_variant_unref(reply)
             }
+            mpris.probeDidFinish(answered: reply != nil)
+        }
+        let parameters: [OpaquePointer?] = [g_variant_new_string(Self.playerInterface), g_variant_new_string("PlaybackStatus")]
+        g_dbus_connection_call(connection, busName, Self.objectPath, Self.propertiesInterface, "Get",
+                               g_variant_new_tuple(parameters, gsize(parameters.count)), nil,
+                               G_DBUS_CALL_FLAGS_NO_AUTO_START, timeoutMilliseconds, nil, onReply,
+                               Unmanaged.passRetained(self).toOpaque())
+    }
+    
+    private func probeDidFinish(answered: Bool) {
+        isProbing = false
+        guard breaker.isOpen else {
+            return
+        }
+        guard answered else {
+            breaker.recordFailedProbe()
+            scheduleProbe()
+            return
+        }
+        breaker.recordSuccess()
+        isDegraded = false
+        refresh(.explicit)
+    }
+}
+
+// MARK: - Polling Fallback
+
+extension MusicPlayers.MPRIS {
+    
+    private func playbackStatusDidChange(isPlaying: Bool) {
+        guard isIdle else {
+            refresh(.playbackStatusSignal)
+            return
+        }
+        wakeups.signals += 1
+        if isPlaying {
+            wakeHandler?()
+        } else {
+            wakeups.shedSignals += 1
         }
     }
     
-    private var track: MusicTrack? {
-        guard let metadata = (gproperty(player, name: "metadata") { g_value_get_variant($0) }) else {
+    /// Clears the handlers, flags and interest set by `MPRISNowPlaying`
+    /// when it goes away, without reading the player. Properties stay as
+    /// they were until the next signal.
+    func detach() {
+        refreshHandler = nil
+        suspendedSignalHandler = nil
+        wakeHandler = nil
+        isDetaching = true
+        isSuspended = false
+        isIdle = false
+        baselineInterest = .all
+        isDetaching = false
+    }
+    
+    /// The track and state as the player reports them now, without
+    /// publishing them, so that a suspended endpoint can be checked and
+    /// stay suspended. Only the track id is decoded.
+    func peek() -> (track: MusicTrack?, state: PlaybackState)? {
+        guard !breaker.isOpen, let properties = readProperties() else {
             return nil
         }
-        
-        let metadataString: (String) -> String? = { key in
-            g_variant_lookup_value(metadata, key, nil).map { g_variant_get_string($0, nil) }.map { String(cString: $0) }
+        return (properties.track, properties.state.delayed(by: outputLatency))
+    }
+    
+    func refresh(_ trigger: SignalHealthMonitor.Trigger) {
+        switch trigger {
+        case .playbackStatusSignal, .seekedSignal, .metadataSignal:
+            wakeups.signals += 1
+        case .poll:
+            wakeups.polls += 1
+        case .initial, .explicit:
+            break
+        }
+        guard !isIdle else {
+            return
+        }
+        guard !isSuspended else {
+            suspendedSignalHandler?(trigger)
+            return
+        }
+        guard !breaker.isOpen else {
+            // A signal shows the player is running again.
+            if trigger != .poll {
+                probe()
+            }
+            return
         }
+        let trace = EventTracer.isEnabled ? EventTracer.shared.begin("\(playerName) \(trigger)") : nil
+        wakeups.refreshes += 1
+        let readStart = DispatchTime.now().uptimeNanoseconds
+        let result = readProperties()
+        let readTime = TimeInterval(DispatchTime.now().uptimeNanoseconds - readStart) / 1_000_000_000
+        wakeups.readTime += readTime
+        wakeups.maximumReadTime = max(wakeups.maximumReadTime, readTime)
+        guard let properties = result else {
+            if !breaker.isOpen {
+                schedulePoll()
+            }
+            return
+        }
+        let track = properties.track
+        reportedPlaybackState = properties.state
+        let state = properties.state.delayed(by: outputLatency)
+        EventTracer.shared.mark(.read, trace: trace)
+        let trackChanged = !currentTrack.isSameTrack(as: track, policy: trackIdentityPolicy)
+        let positionJumped = !trackChanged && playbackState.isPlaying == state.isPlaying && !playbackState.approximateEqual(to: state)
+        let stateChanged = !playbackState.approximateEqual(to: state)
+        // New metadata for the same track, like the title of a radio stream,
+        // or artwork that came late. Status and seek signals don't carry it.
+        let metadataChanged = !trackChanged
+            && (trigger != .playbackStatusSignal && trigger != .seekedSignal)
+            && !PlayerChanges(metadataFrom: currentTrack, to: track, comparing: interest).isEmpty
+        EventTracer.withCurrent(trace) {
+            if trackChanged || metadataChanged {
+                currentTrack = track
+            }
+            if trackChanged || stateChanged {
+                playbackState = state
+            }
+        }
+        EventTracer.shared.mark(.publish, trace: trace)
         
-        guard let id = metadataString("mpris:trackid") else {
-            return nil
+        let now = ProcessInfo.processInfo.systemUptime
+        // Without seek signals, a jump isn't a sign of a missing one.
+        if let signal = signalHealth.observe(trigger, trackChanged: trackChanged, positionJumped: positionJumped && followsSeeks, at: now) {
+            scheduleSignalCheck(signal, since: now)
+        }
+        schedulePoll()
+        scheduleTrackEndCheck()
+        refreshHandler?(trackChanged || stateChanged || metadataChanged)
+    }
+    
+    /// Gives a suspected signal its grace period before counting it as missing.
+    private func scheduleSignalCheck(_ signal: SignalHealthMonitor.Signal, since: TimeInterval) {
+        signalCheckTimeouts.removeAll { !$0.isPending }
+        let timeout = GTimeout(after: signalHealth.policy.signalGracePeriod) { [unowned self] in
+            let wasPolling = self.signalHealth.needsPolling
+            self.signalHealth.confirm(signal, since: since)
+            if !wasPolling {
+                self.schedulePoll()
+            }
+        }
+        signalCheckTimeouts.append(timeout)
+    }
+    
+    private func schedulePoll() {
+        guard signalHealth.needsPolling else {
+            return
+        }
+        pollTimeout = GTimeout(after: signalHealth.pollInterval) { [unowned self] in
+            self.poll()
+        }
+    }
+    
+    private func poll() {
+        guard PollBudget.shared.acquire() else {
+            pollTimeout = GTimeout(after: PollBudget.shared.retryInterval) { [unowned self] in
+                self.poll()
+            }
+            return
+        }
+        refresh(.poll)
+    }
+    
+    /// A well-behaved player announces the next track right when the current
+    /// one ends. Look once at that moment to catch players that don't, once
+    /// they have missed a signal, so that the others pay nothing.
+    private func scheduleTrackEndCheck() {
+        trackEndTimeout = nil
+        guard signalHealth.strikes > 0,
+            !signalHealth.needsPolling,
+            followsTrack,
+            playbackState.isPlaying,
+            let duration = currentTrack?.duration,
+            duration > 0 else {
+            return
+        }
+        let remaining = duration - playbackState.time
+        guard remaining > 0 else {
+            return
+        }
+        trackEndTimeout = GTimeout(after: remaining + signalHealth.policy.signalGracePeriod) { [unowned self] in
+            self.poll()
         }
-        let title = playerctl_player_get_title(player, nil).map { String(cString: $0) }
-        let album = playerctl_player_get_album(player, nil).map { String(cString: $0) }
-        let artist = playerctl_player_get_artist(player, nil).map { String(cString: $0) }
-        let length = g_variant_lookup_value(metadata, "mpris:length", nil).map { g_variant_get_int64($0) } ?? 0
-        let duration = Double(length) / 1_000_000
-        return MusicTrack(id: id, title: title, album: album, artist: artist, duration: duration,
-                          fileURL: metadataString("xesam:url").flatMap { URL(string: $0) },
-                          artwork: metadataString("mpris:artUrl").flatMap { URL(string: $0) })
     }
 }
 
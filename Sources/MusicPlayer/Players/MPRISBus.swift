@@ -0,0 +1,145 @@
+//
+//  MPRISBus.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if os(Linux)
+
+import Foundation
+import playerctl
+
+/// A D-Bus message bus that MPRIS players are found on.
+public enum MPRISBus: Hashable, CustomStringConvertible {
+    
+    /// The session bus of this process, from `DBUS_SESSION_BUS_ADDRESS`.
+    case session
+    
+    case system
+    
+    /// Any other bus, like another user's session bus at
+    /// `unix:path=/run/user/1001/bus`.
+    case address(String)
+    
+    /// Added to the identifiers of the players on this bus, after an `@`,
+    /// except on the session bus.
+    public var description: String {
+        switch self {
+        case .session:              return "session"
+        case .system:               return "system"
+        case let .address(address): return address
+        }
+    }
+}
+
+/// A connection to one bus, shared by all its players, that finds MPRIS
+/// players and follows them coming and going.
+final class MPRISBusWatcher {
+    
+    static let busNamePrefix = "org.mpris.MediaPlayer2."
+    
+    /// Discovery calls go to the bus itself, which always answers quickly.
+    private static let timeoutMilliseconds: gint = 1000
+    
+    let bus: MPRISBus
+    let connection: OpaquePointer /* GDBusConnection* */
+    private var subscription: guint = 0
+    
+    /// Called with the instance name, like `vlc`, and its old and new
+    /// unique owners, either of which is empty.
+    var ownerChangeHandler: ((_ instance: String, _ oldOwner: String, _ newOwner: String) -> Void)?
+    
+    init?(bus: MPRISBus) {
+        var error: UnsafeMutablePointer<GError>?
+        let connection: OpaquePointer?
+        switch bus {
+        case .session:
+            connection = g_bus_get_sync(G_BUS_TYPE_SESSION, nil, &error)
+        case .system:
+            connection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, nil, &error)
+        case let .address(address):
+            let flags = GDBusConnectionFlags(G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT.rawValue
+                | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION.rawValue)
+            connection = g_dbus_connection_new_for_address_sync(address, flags, nil, nil, &error)
+        }
+        g_clear_error(&error)
+        guard let connected = connection else {
+            return nil
+        }
+        self.bus = bus
+        self.connection = connected
+        
+        let onNameOwnerChanged: @convention(c) (OpaquePointer?, UnsafePointer<gchar>?, UnsafePointer<gchar>?,
+                                                UnsafePointer<gchar>?, UnsafePointer<gchar>?,
+                                                OpaquePointer? /* GVariant* */, gpointer?) -> Void
+            = { _, _, _, _, _, parameters, data in
+                let strings = (0..<3).map { (index: gsize) -> String in
+                    let value = g_variant_get_child_value(parameters, index)!
+                    defer { g_variant_unref(value) }
+                    return String(cString: g_variant_get_string(value, nil))
+                }
+                guard strings[0].hasPrefix(MPRISBusWatcher.busNamePrefix) else {
+                    return
+                }
+                let instance = String(strings[0].dropFirst(MPRISBusWatcher.busNamePrefix.count))
+                data!.unretainedCast(to: MPRISBusWatcher.self).ownerChangeHandler?(instance, strings[1], strings[2])
+            }
+        // Only the names of MPRIS players wake us up, not every client that
+        // connects to the bus.
+        subscription = g_dbus_connection_signal_subscribe(connected, "org.freedesktop.DBus", "org.freedesktop.DBus",
+                                                          "NameOwnerChanged", "/org/freedesktop/DBus", "org.mpris.MediaPlayer2",
+                                                          G_DBUS_SIGNAL_FLAGS_MATCH_ARG0_NAMESPACE, onNameOwnerChanged,
+                                                          Unmanaged.passUnretained(self).toOpaque(), nil)
+    }
+    
+    deinit {
+        g_dbus_connection_signal_unsubscribe(connection, subscription)
+        g_object_unref(UnsafeMutableRawPointer(connection))
+    }
+    
+    /// Instance names and unique owners of the MPRIS players on the bus.
+    func players() -> [(instance: String, owner: String)] {
+        guard let reply = callBus("ListNames", parameters: nil) else {
+            return []
+        }
+        defer { g_variant_unref(reply) }
+        let names = g_variant_get_child_value(reply, 0)!
+        defer { g_variant_unref(names) }
+        var players: [(instance: String, owner: String)] = []
+        for index in 0..<g_variant_n_children(names) {
+            let value = g_variant_get_child_value(names, index)!
+            let busName = String(cString: g_variant_get_string(value, nil))
+            g_variant_unref(value)
+            guard busName.hasPrefix(MPRISBusWatcher.busNamePrefix), let owner = self.owner(of: busName) else {
+                continue
+            }
+            players.append((String(busName.dropFirst(MPRISBusWatcher.busNamePrefix.count)), owner))
+        }
+        return players
+    }
+    
+    private func owner(of busName: String) -> String? {
+        let parameters: [OpaquePointer?] = [g_variant_new_string(busName)]
+        guard let reply = callBus("GetNameOwner", parameters: g_variant_new_tuple(parameters, gsize(parameters.count))) else {
+            return nil
+        }
+        defer { g_variant_unref(reply) }
+        let owner = g_variant_get_child_value(reply, 0)!
+        defer { g_variant_unref(owner) }
+        return String(cString: g_variant_get_string(owner, nil))
+    }
+    
+    private func callBus(_ method: String, parameters: OpaquePointer?) -> OpaquePointer? {
+        var error: UnsafeMutablePointer<GError>?
+        let reply = g_dbus_connection_call_sync(connection, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+                                                "org.freedesktop.DBus", method, parameters, nil,
+                                                G_DBUS_CALL_FLAGS_NONE, MPRISBusWatcher.timeoutMilliseconds, nil, &error)
+        g_clear_error(&error)
+        return reply
+    }
+}
+
+#endif
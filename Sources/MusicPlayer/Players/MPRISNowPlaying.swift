@@ -15,33 +15,80 @@ extension MusicPlayers {
     
     public final class MPRISNowPlaying: NowPlaying {
         
-        private let manager: UnsafeMutablePointer<PlayerctlPlayerManager>
+        private let manager: UnsafeMutablePointer<PlayerctlPlayerManager>?
+        private let watchers: [MPRISBusWatcher]
         private var signals: [gulong] = []
         
-        public init?() {
-            guard let manager = playerctl_player_manager_new(nil) else {
-                return nil
+        /// The buses searched for players.
+        public let buses: [MPRISBus]
+        
+        /// Every MPRIS endpoint on the bus, including the ones left out of
+        /// `players` because they show the same media as another.
+        public private(set) var endpoints: [MPRIS] = []
+        
+        /// Finds endpoints that show the same media. Of each group, only the
+        /// endpoint ranked first by `selectionPolicy`, or else found first,
+        /// stays in `players`. The others are suspended, so their changes are
+        /// not read or published, until they stop matching.
+        ///
+        /// Off by default, so that every endpoint stays in `players`. Set it
+        /// to `.enabled` to collapse duplicates.
+        public var duplicatePolicy: DuplicateMediaPolicy = .disabled {
+            didSet {
+                endpoints.forEach(updateBaselineInterest(of:))
+                expandDuplicates { _ in true }
+                endpoints.forEach(collapseDuplicates)
             }
-            self.manager = manager
-            
-            var players: [MusicPlayerProtocol] = []
-            let playerNames: UnsafeMutablePointer<GList>? = playerctl_list_players(nil)
-            var cur = playerNames
-            while (cur != nil) {
-                let playerName = cur!.pointee.data.assumingMemoryBound(to: PlayerctlPlayerName.self)
-                let name = String(cString: playerName.pointee.name)
-                let player = playerctl_player_new_from_name(playerName, nil)
-                playerctl_player_name_free(playerName)
-                if player == nil {
-                    continue
+        }
+        
+        /// Followed by every endpoint, on top of what subscribers of
+        /// `changes(of:)`, here or on an endpoint, ask for. Everything by
+        /// default. Narrow it, down to `[]`, when every consumer subscribes
+        /// with an interest. The playback status, which players are selected
+        /// by, and the fields `duplicatePolicy` compares are always followed.
+        public var endpointInterest: PlayerChanges = .all {
+            didSet {
+                endpoints.forEach(updateBaselineInterest(of:))
+            }
+        }
+        
+        /// When to stop following endpoints that all stopped playing.
+        public var idlePolicy: IdlePolicy = .default {
+            didSet {
+                idleTimeout = nil
+                if idlePolicy.isEnabled {
+                    updateIdleTimeout()
+                } else {
+                    wake()
                 }
-                playerctl_player_manager_manage_player(manager, player)
-                players.append(MPRIS(player: player!, name: name))
-                cur = cur!.pointee.next
             }
-            g_list_free(playerNames)
-            
-            super.init(players: players)
+        }
+        
+        /// Whether only playback status and new endpoints are watched.
+        public private(set) var isIdle = false
+        
+        /// Wakeups of all endpoints on the bus so far.
+        public var wakeups: WakeupCounters {
+            return endpoints.reduce(WakeupCounters()) { $0 + $1.wakeups }
+        }
+        
+        /// Collapsed endpoint to the endpoint it duplicates.
+        private var primaries: [ObjectIdentifier: MPRIS] = [:]
+        private var validationTimeouts: [ObjectIdentifier: GTimeout] = [:]
+        private var discoveryTimeout: GTimeout?
+        private var idleTimeout: GTimeout?
+        
+        /// Follows the players on the session and system buses.
+        ///
+        /// Without a `stateCache`, the players on the bus are found and read
+        /// before this returns. With one, the last saved state is designated
+        /// right away, and players are found on the next run of the GLib main
+        /// loop.
+        public convenience init?(stateCache: PlayerStateCache? = nil) {
+            guard let manager = playerctl_player_manager_new(nil) else {
+                return nil
+            }
+            self.init(manager: manager, watchers: [], buses: [.session, .system], stateCache: stateCache)
             
             let onNameAppeared: @convention(c) (UnsafeMutablePointer<PlayerctlPlayerManager>?,
                                                 UnsafeMutablePointer<PlayerctlPlayerName>?,
@@ -50,7 +97,7 @@ extension MusicPlayers {
                     let `self`: MPRISNowPlaying = Unmanaged.fromOpaque(data!).takeUnretainedValue()
                     if let player = playerctl_player_new_from_name(name, nil) {
                         playerctl_player_manager_manage_player(`self`.manager, player)
-                        `self`.players.append(MPRIS(player: player, name: String(cString: name!.pointee.name)))
+                        `self`.add(MPRIS(player: player, name: String(cString: name!.pointee.name)))
                     }
                 }
             
@@ -61,7 +108,10 @@ extension MusicPlayers {
                     if player == nil {
                         return
                     }
-                    data?.unretainedCast(to: MPRISNowPlaying.self).players.removeAll { ($0 as? MPRIS)?.player == player }
+                    let `self` = data!.unretainedCast(to: MPRISNowPlaying.self)
+                    if let endpoint = `self`.endpoints.first(where: { $0.player == player }) {
+                        `self`.remove(endpoint)
+                    }
                 }
             
             let pself = Unmanaged.passUnretained(self).toOpaque()
@@ -73,12 +123,311 @@ extension MusicPlayers {
             )
         }
         
+        /// Follows the players on all of `buses` at once, like the session
+        /// buses of several users and the system bus, on one GLib main loop.
+        /// Each bus has one connection, shared by its players, and players
+        /// not on the session bus of this process carry their bus in
+        /// `playerIdentifier`, like `mpd@system`.
+        ///
+        /// Buses that can't be reached are left out of `buses`. Fails if none
+        /// can. Players are found like `init(stateCache:)` does.
+        public convenience init?(buses: [MPRISBus], stateCache: PlayerStateCache? = nil) {
+            var seen = Set<MPRISBus>()
+            let watchers = buses.filter { seen.insert($0).inserted }.compactMap(MPRISBusWatcher.init)
+            guard !watchers.isEmpty else {
+                return nil
+            }
+            self.init(manager: nil, watchers: watchers, buses: watchers.map { $0.bus }, stateCache: stateCache)
+            
+            for watcher in watchers {
+                watcher.ownerChangeHandler = { [unowned self, unowned watcher] instance, oldOwner, newOwner in
+                    self.ownerDidChange(on: watcher, instance: instance, from: oldOwner, to: newOwner)
+                }
+            }
+        }
+        
+        private init(manager: UnsafeMutablePointer<PlayerctlPlayerManager>?, watchers: [MPRISBusWatcher], buses: [MPRISBus], stateCache: PlayerStateCache?) {
+            self.manager = manager
+            self.watchers = watchers
+            self.buses = buses
+            
+            if stateCache == nil {
+                let endpoints = MPRISNowPlaying.discoverEndpoints(manager: manager, watchers: watchers, excluding: [])
+                self.endpoints = endpoints
+                super.init(players: endpoints)
+                endpoints.forEach(watch)
+                endpoints.forEach(collapseDuplicates)
+                updateIdleTimeout()
+            } else {
+                super.init(players: [], stateCache: stateCache)
+                discoveryTimeout = GTimeout(after: 0) { [unowned self] in
+                    self.discoverDeferredEndpoints()
+                }
+            }
+        }
+        
         deinit {
             for var signal in signals {
                 g_clear_signal_handler(&signal, manager)
             }
-            g_object_unref(manager)
+            watchers.forEach { $0.ownerChangeHandler = nil }
+            endpoints.forEach { $0.detach() }
+            if let manager = manager {
+                g_object_unref(manager)
+            }
+        }
+        
+        private static func discoverEndpoints(manager: UnsafeMutablePointer<PlayerctlPlayerManager>?, watchers: [MPRISBusWatcher], excluding known: Set<String>) -> [MPRIS] {
+            var endpoints: [MPRIS] = []
+            for watcher in watchers {
+                for (instance, owner) in watcher.players() where !known.contains(MPRIS.identifier(name: instance, bus: watcher.bus)) {
+                    endpoints.append(MPRIS(connection: watcher.connection, bus: watcher.bus, instance: instance, owner: owner))
+                }
+            }
+            guard let manager = manager else {
+                return endpoints
+            }
+            let playerNames: UnsafeMutablePointer<GList>? = playerctl_list_players(nil)
+            var cur = playerNames
+            while (cur != nil) {
+                let playerName = cur!.pointee.data.assumingMemoryBound(to: PlayerctlPlayerName.self)
+                let name = String(cString: playerName.pointee.name)
+                let bus: MPRISBus = playerName.pointee.source.rawValue == PLAYERCTL_SOURCE_DBUS_SYSTEM.rawValue ? .system : .session
+                let player = known.contains(MPRIS.identifier(name: name, bus: bus)) ? nil : playerctl_player_new_from_name(playerName, nil)
+                playerctl_player_name_free(playerName)
+                cur = cur!.pointee.next
+                if player == nil {
+                    continue
+                }
+                playerctl_player_manager_manage_player(manager, player)
+                endpoints.append(MPRIS(player: player!, name: name))
+            }
+            g_list_free(playerNames)
+            return endpoints
+        }
+        
+        private func discoverDeferredEndpoints() {
+            // Players that appeared in the meantime are already known.
+            let found = MPRISNowPlaying.discoverEndpoints(manager: manager, watchers: watchers, excluding: Set(endpoints.map { $0.playerIdentifier }))
+            endpoints += found
+            found.forEach(watch)
+            // Set even if empty, which ends the provisional state.
+            players = endpoints
+            endpoints.forEach(collapseDuplicates)
+            updateIdleTimeout()
+        }
+        
+        /// The endpoint that `endpoint` duplicates, if it was collapsed.
+        public func primary(of endpoint: MPRIS) -> MPRIS? {
+            return primaries[ObjectIdentifier(endpoint)]
+        }
+        
+        private func add(_ endpoint: MPRIS) {
+            endpoints.append(endpoint)
+            watch(endpoint)
+            // A new player is activity.
+            wake()
+            guard discoveryTimeout?.isPending != true else {
+                return
+            }
+            updatePlayers()
+            collapseDuplicates(of: endpoint)
+            updateIdleTimeout()
+        }
+        
+        private func remove(_ endpoint: MPRIS) {
+            guard let index = endpoints.firstIndex(where: { $0 === endpoint }) else {
+                return
+            }
+            endpoints.remove(at: index)
+            let id = ObjectIdentifier(endpoint)
+            endpoint.refreshHandler = nil
+            endpoint.suspendedSignalHandler = nil
+            endpoint.wakeHandler = nil
+            primaries[id] = nil
+            validationTimeouts[id] = nil
+            expandDuplicates { $0 === endpoint }
+            updateIdleTimeout()
+        }
+        
+        /// A player that restarts gets a new owner, and a new endpoint.
+        private func ownerDidChange(on watcher: MPRISBusWatcher, instance: String, from oldOwner: String, to newOwner: String) {
+            if !oldOwner.isEmpty, let endpoint = endpoints.first(where: { $0.bus == watcher.bus && $0.playerName == instance }) {
+                remove(endpoint)
+            }
+            // A player that appeared during discovery is already known.
+            if !newOwner.isEmpty, !endpoints.contains(where: { $0.bus == watcher.bus && $0.playerName == instance }) {
+                add(MPRIS(connection: watcher.connection, bus: watcher.bus, instance: instance, owner: newOwner))
+            }
+        }
+    }
+}
+
+// MARK: - Duplicates
+
+extension MusicPlayers.MPRISNowPlaying {
+    
+    private func watch(_ endpoint: MusicPlayers.MPRIS) {
+        updateBaselineInterest(of: endpoint)
+        endpoint.refreshHandler = { [unowned self, unowned endpoint] changed in
+            if changed {
+                self.collapseDuplicates(of: endpoint)
+                self.updateIdleTimeout()
+            }
+        }
+        endpoint.wakeHandler = { [unowned self] in
+            self.wake()
+        }
+        endpoint.suspendedSignalHandler = { [unowned self, unowned endpoint] trigger in
+            // A duplicate follows its primary, which reports seeks itself.
+            if trigger != .seekedSignal {
+                self.scheduleValidation(of: endpoint)
+            }
+        }
+    }
+    
+    private func updateBaselineInterest(of endpoint: MusicPlayers.MPRIS) {
+        endpoint.baselineInterest = endpointInterest.union(duplicatePolicy.interest).union(.stateKind)
+    }
+    
+    private func updatePlayers() {
+        let active = endpoints.filter { primaries[ObjectIdentifier($0)] == nil }
+        if !active.elementsEqual(players, by: { $0 === $1 }) {
+            players = active
+        }
+    }
+    
+    /// Collapses an active endpoint, or the endpoint it duplicates,
+    /// whichever ranks lower.
+    private func collapseDuplicates(of endpoint: MusicPlayers.MPRIS) {
+        guard duplicatePolicy.isEnabled, primaries[ObjectIdentifier(endpoint)] == nil else {
+            return
+        }
+        let other = endpoints.first {
+            $0 !== endpoint && primaries[ObjectIdentifier($0)] == nil && duplicatePolicy.isSameMedia(endpoint, $0)
+        }
+        guard let match = other else {
+            return
+        }
+        if isPreferred(endpoint, over: match) {
+            collapse(match, into: endpoint)
+        } else {
+            collapse(endpoint, into: match)
+        }
+        updatePlayers()
+    }
+    
+    private func collapse(_ duplicate: MusicPlayers.MPRIS, into primary: MusicPlayers.MPRIS) {
+        for (id, endpoint) in primaries where endpoint === duplicate {
+            primaries[id] = primary
+        }
+        primaries[ObjectIdentifier(duplicate)] = primary
+        duplicate.isSuspended = true
+    }
+    
+    private func isPreferred(_ endpoint: MusicPlayers.MPRIS, over other: MusicPlayers.MPRIS) -> Bool {
+        // A denied endpoint, such as our own export, would hide the real one.
+        let policy = effectiveSelectionPolicy
+        let isDenied = policy.isDenied(endpoint.playerIdentifier)
+        if isDenied != policy.isDenied(other.playerIdentifier) {
+            return !isDenied
+        }
+        let rank = policy.rank(of: endpoint.playerIdentifier)
+        let otherRank = policy.rank(of: other.playerIdentifier)
+        if rank != otherRank {
+            return rank < otherRank
+        }
+        let index = endpoints.firstIndex { $0 === endpoint } ?? .max
+        let otherIndex = endpoints.firstIndex { $0 === other } ?? .max
+        return index < otherIndex
+    }
+    
+    /// Checks a collapsed endpoint that reported a change. The delay lets the
+    /// primary, which usually reports the same change, go first.
+    private func scheduleValidation(of duplicate: MusicPlayers.MPRIS) {
+        validationTimeouts[ObjectIdentifier(duplicate)] = GTimeout(after: 0.5) { [unowned self, unowned duplicate] in
+            self.validate(duplicate)
+        }
+    }
+    
+    private func validate(_ duplicate: MusicPlayers.MPRIS) {
+        let id = ObjectIdentifier(duplicate)
+        validationTimeouts[id] = nil
+        guard let primary = primaries[id] else {
+            return
+        }
+        // Read without publishing. A duplicate that still shows the same
+        // media stays suspended, and one that doesn't answer is left alone.
+        guard let peeked = duplicate.peek() else {
+            return
+        }
+        let isSame: Bool
+        if peeked.track?.id == duplicate.currentTrack?.id {
+            // Still the track it was collapsed with, only the state can
+            // have drifted from the primary.
+            isSame = duplicatePolicy.isEnabled
+                && peeked.state != .stopped
+                && peeked.state.approximateEqual(to: primary.playbackState, tolerate: duplicatePolicy.positionTolerance)
+        } else {
+            isSame = duplicatePolicy.isSameMedia((peeked.track, peeked.state), (primary.currentTrack, primary.playbackState))
+        }
+        if isSame {
+            return
+        }
+        duplicate.isSuspended = false
+        primaries[id] = nil
+        updatePlayers()
+        collapseDuplicates(of: duplicate)
+    }
+    
+    /// Brings back the collapsed endpoints whose primary passes `isIncluded`.
+    private func expandDuplicates(where isIncluded: (MusicPlayers.MPRIS) -> Bool) {
+        var expanded: [MusicPlayers.MPRIS] = []
+        for (id, primary) in primaries where isIncluded(primary) {
+            primaries[id] = nil
+            validationTimeouts[id] = nil
+            if let endpoint = endpoints.first(where: { ObjectIdentifier($0) == id }) {
+                expanded.append(endpoint)
+            }
+        }
+        expanded.forEach { $0.isSuspended = false }
+        updatePlayers()
+        expanded.forEach(collapseDuplicates)
+    }
+}
+
+// MARK: - Idle Mode
+
+extension MusicPlayers.MPRISNowPlaying {
+    
+    private func updateIdleTimeout() {
+        guard idlePolicy.isEnabled, !isIdle, discoveryTimeout?.isPending != true else {
+            return
+        }
+        if endpoints.contains(where: { $0.playbackState.isPlaying }) {
+            idleTimeout = nil
+        } else if idleTimeout?.isPending != true {
+            idleTimeout = GTimeout(after: idlePolicy.threshold) { [unowned self] in
+                self.enterIdle()
+            }
+        }
+    }
+    
+    private func enterIdle() {
+        isIdle = true
+        idleTimeout = nil
+        validationTimeouts = [:]
+        endpoints.forEach { $0.isIdle = true }
+    }
+    
+    /// Reads every endpoint again, which also checks for duplicates.
+    private func wake() {
+        guard isIdle else {
+            return
         }
+        isIdle = false
+        endpoints.forEach { $0.isIdle = false }
+        updateIdleTimeout()
     }
 }
 
@@ -21,40 +21,97 @@ extension MusicPlayers {
         
         public var players: [MusicPlayerProtocol] {
             didSet {
-                selectNewPlayer()
+                selection.setPlayers(players)
             }
         }
         
-        private var selectNewPlayerCanceller: AnyCancellable?
+        /// Decides which of `players` to follow.
+        public var selectionPolicy: PlayerSelectionPolicy {
+            get { return selection.policy }
+            set { selection.policy = newValue }
+        }
+        
+        /// How often the designated player changed.
+        public var selectionStatistics: PlayerSelectionStatistics {
+            return selection.statistics
+        }
+        
+        /// `selectionPolicy` with the excluded players denied.
+        var effectiveSelectionPolicy: PlayerSelectionPolicy {
+            return selection.effectivePolicy
+        }
+        
+        /// Where the state of `players` is saved on every change.
+        public let stateCache: PlayerStateCache?
         
-        public init(players: [MusicPlayerProtocol]) {
+        /// Whether `designatedPlayer` is the last known state from
+        /// `stateCache`, shown until `players` are known.
+        public var isProvisional: Bool {
+            return designatedPlayer is Provisional
+        }
+        
+        private let selection: PlayerSelectionLoop<MusicPlayerProtocol>
+        
+        // The last snapshot handed to `stateCache`, which is only saved
+        // again once it changes.
+        private var savedSnapshot: PlayerStateCache.Snapshot?
+        private let savedSnapshotLock = NSLock()
+        
+        /// With a `stateCache` and no `players` yet, the last saved state is
+        /// designated right away, as a `Provisional` player, until `players`
+        /// are set.
+        public init(players: [MusicPlayerProtocol], selectionPolicy: PlayerSelectionPolicy = .default, stateCache: PlayerStateCache? = nil) {
+            let isAwaitingPlayers = players.isEmpty && stateCache != nil
             self.players = players
+            self.selection = PlayerSelectionLoop(policy: selectionPolicy, isHeld: isAwaitingPlayers,
+                                                 identifier: { $0.playerIdentifier },
+                                                 changes: { $0.snapshots })
+            self.stateCache = stateCache
             super.init()
-            selectNewPlayer()
-            selectNewPlayerCanceller = $designatedPlayer
-                .map {
-                    $0?.objectWillChange.eraseToAnyPublisher() ??
-                        Publishers.MergeMany(players.map { $0.objectWillChange }).eraseToAnyPublisher()
-                }
-                .switchToLatest()
-                .receive(on: DispatchQueue.playerUpdate.cx)
-                .sink { [weak self] _ in
-                    self?.selectNewPlayer()
-                }
-        }
-        
-        private func selectNewPlayer() {
-            var newPlayer: MusicPlayerProtocol?
-            if designatedPlayer?.playbackState.isPlaying == true {
-                newPlayer = designatedPlayer
-            } else if let playing = players.first(where: { $0.playbackState.isPlaying }) {
-                newPlayer = playing
-            } else if let running = players.first(where: { $0.playbackState != .stopped }) {
-                newPlayer = running
+            if isAwaitingPlayers {
+                super.designatedPlayer = stateCache?.load()?.provisionalPlayer()
             }
-            if newPlayer !== designatedPlayer {
-                super.designatedPlayer = newPlayer
+            selection.current = { [weak self] in self?.designatedPlayer }
+            selection.designate = { [weak self] in self?.designate($0) }
+            selection.didEvaluate = { [weak self] in self?.saveState() }
+            selection.setPlayers(players, releasingHold: false)
+        }
+        
+        public func resetSelectionStatistics() {
+            selection.resetStatistics()
+        }
+        
+        private func designate(_ player: MusicPlayerProtocol?) {
+            super.designatedPlayer = player
+        }
+        
+        private func saveState() {
+            guard let stateCache = stateCache else {
+                return
+            }
+            let players = selection.playerSnapshots.map { player, snapshot in
+                PlayerStateCache.Snapshot.Player(identifier: player.playerIdentifier, track: snapshot.track, playbackState: snapshot.state)
+            }
+            let snapshot = PlayerStateCache.Snapshot(players: players, designatedIdentifier: designatedPlayer?.playerIdentifier)
+            savedSnapshotLock.lock()
+            defer { savedSnapshotLock.unlock() }
+            if let saved = savedSnapshot, saved.hasSameState(as: snapshot) {
+                return
+            }
+            savedSnapshot = snapshot
+            stateCache.setNeedsSave { [weak self] in
+                guard let self = self else { return nil }
+                self.savedSnapshotLock.lock()
+                defer { self.savedSnapshotLock.unlock() }
+                return self.savedSnapshot
             }
         }
     }
 }
+
+extension MusicPlayers.NowPlaying: PlayerSelecting {
+    
+    public func excludePlayers(matching identifier: String) -> AnyCancellable {
+        return selection.exclude(identifier)
+    }
+}
@@ -0,0 +1,60 @@
+//
+//  Provisional.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+extension MusicPlayers {
+    
+    /// The last known state of a player, from a `PlayerStateCache`, shown
+    /// until the live player is found. It never changes, and ignores
+    /// commands.
+    public final class Provisional: ObservableObject {
+        
+        public let playerIdentifier: String
+        public let currentTrack: MusicTrack?
+        public let playbackState: PlaybackState
+        
+        public init(identifier: String, track: MusicTrack?, state: PlaybackState) {
+            playerIdentifier = identifier
+            currentTrack = track
+            playbackState = state
+        }
+    }
+}
+
+extension MusicPlayers.Provisional: MusicPlayerProtocol {
+    
+    public var currentTrackWillChange: AnyPublisher<MusicTrack?, Never> {
+        return Just(currentTrack).eraseToAnyPublisher()
+    }
+    
+    public var playbackStateWillChange: AnyPublisher<PlaybackState, Never> {
+        return Just(playbackState).eraseToAnyPublisher()
+    }
+    
+    public var name: MusicPlayerName? {
+        return nil
+    }
+    
+    public var playbackTime: TimeInterval {
+        get { return playbackState.time }
+        set {}
+    }
+    
+    public func resume() {}
+    
+    public func pause() {}
+    
+    public func skipToNextItem() {}
+    
+    public func skipToPreviousItem() {}
+    
+    public func updatePlayerState() {}
+}
@@ -19,6 +19,7 @@ extension MusicPlayers {
     public final class Scriptable: ObservableObject {
         
         private var player: LXScriptingMusicPlayer
+        private let queue: DispatchQueue
         private var cancellers: Set<AnyCancellable> = []
         
         @Published public private(set) var currentTrack: MusicTrack?
@@ -28,23 +29,28 @@ extension MusicPlayers {
             return player.playerBundleID
         }
         
+        public var playerIdentifier: String {
+            return playerBundleID
+        }
+        
         public init?(name: MusicPlayerName) {
             guard let lxNmae = name.lxName, let player = LXScriptingMusicPlayer(name: lxNmae) else {
                 return nil
             }
             self.player = player
+            self.queue = DispatchQueue.player(player.playerBundleID)
             self.currentTrack = player.currentTrack.map(MusicTrack.init)
             self.playbackState = PlaybackState(lxState: player.playerState)
             player.cx
                 .publisher(for: \.currentTrack)
                 .map { $0.map(MusicTrack.init) }
-                .receive(on: DispatchQueue.playerUpdate.cx)
+                .receive(on: queue.cx)
                 .assign(to: \.currentTrack, weaklyOn: self)
                 .store(in: &cancellers)
             player.cx
                 .publisher(for: \.playerState)
                 .map(PlaybackState.init)
-                .receive(on: DispatchQueue.playerUpdate.cx)
+                .receive(on: queue.cx)
                 .assign(to: \.playbackState, weaklyOn: self)
                 .store(in: &cancellers)
         }
@@ -93,6 +99,11 @@ extension MusicPlayers.Scriptable: MusicPlayerProtocol {
     public func updatePlayerState() {
         player.updatePlayerState()
     }
+    
+    /// On the queue of the player.
+    public func performInContext(_ body: @escaping () -> Void) {
+        queue.async(execute: body)
+    }
 }
 
 extension MusicPlayerName {
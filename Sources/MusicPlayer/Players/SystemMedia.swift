@@ -25,31 +25,74 @@ extension MusicPlayers {
         @Published public private(set) var playbackState: PlaybackState = .stopped
         
         private var systemPlaybackState: SystemPlaybackState?
+        private let queue = DispatchQueue.player("SystemMedia")
+        
+        /// Playback state as MediaRemote reports it, before `OutputLatency`.
+        private var reportedPlaybackState: PlaybackState = .stopped
+        private var latencyCanceller: AnyCancellable?
+        
+        /// Decides when the track has changed. Without a unique identifier the
+        /// id is derived from the metadata and flaps with it.
+        public var trackIdentityPolicy: TrackIdentityPolicy = .automatic
+        
+        /// Followed even without subscribers of `changes(of:)`. Everything
+        /// by default, as `currentTrack` and `playbackState` can be read at
+        /// any time. Narrow it when every consumer subscribes with an
+        /// interest. The playback state is always followed.
+        public var baselineInterest: PlayerChanges = .all {
+            didSet {
+                queue.async { self.updateInterest() }
+            }
+        }
+        
+        /// `baselineInterest` and the interest of every subscriber. Now
+        /// playing info notifications are only observed for the track, its
+        /// metadata or position jumps, and artwork is only decoded for
+        /// `.artwork`. `currentTrack` goes stale without the track and its
+        /// metadata.
+        public private(set) var interest: PlayerChanges = .all
+        
+        private let interests = PlayerInterestRegistry()
+        private var infoObserver: NSObjectProtocol?
         
         public init?() {
             guard Self.available else { return nil }
-            MRMediaRemoteRegisterForNowPlayingNotifications_?(DispatchQueue.playerUpdate)
+            MRMediaRemoteRegisterForNowPlayingNotifications_?(queue)
             
             let nc = NotificationCenter.default
             nc.addObserver(forName: .mediaRemoteNowPlayingApplicationPlaybackStateDidChange, object: nil, queue: nil) { [weak self] n in
                 self?.mediaRemoteNowPlayingApplicationPlaybackStateDidChange(n: n)
             }
-            nc.addObserver(forName: .mediaRemoteNowPlayingInfoDidChange, object: nil, queue: nil) { [weak self] n in
-                self?.mediaRemoteNowPlayingInfoDidChange(n: n)
+            observeNowPlayingInfo(true)
+            interests.unionDidChange = { [weak self] in
+                guard let self = self else { return }
+                self.queue.async { self.updateInterest() }
             }
             
-            MRMediaRemoteGetNowPlayingApplicationIsPlaying_?(DispatchQueue.playerUpdate) { [weak self] isPlaying in
+            MRMediaRemoteGetNowPlayingApplicationIsPlaying_?(queue) { [weak self] isPlaying in
                 self?.systemPlaybackState = isPlaying.boolValue ? .playing : .paused
                 self?.updatePlayerState()
             }
+            
+            latencyCanceller = outputLatencyDidChange
+                .receive(on: queue.cx)
+                .sink { [weak self] in
+                    guard let self = self else { return }
+                    let state = self.reportedPlaybackState.delayed(by: self.outputLatency)
+                    if state != self.playbackState {
+                        self.playbackState = state
+                    }
+                }
         }
         
         deinit {
+            observeNowPlayingInfo(false)
             MRMediaRemoteUnregisterForNowPlayingNotifications_?()
         }
         
         private func getNowPlayingInfoCallback(_ infoDict: CFDictionary?) {
             guard let infoDict = infoDict as NSDictionary? else {
+                reportedPlaybackState = .stopped
                 playbackState = .stopped
                 currentTrack = nil
                 return
@@ -64,18 +107,25 @@ extension MusicPlayers {
             default:
                 newState = .stopped
             }
-            if !playbackState.approximateEqual(to: newState) {
-                playbackState = newState
+            reportedPlaybackState = newState
+            let compensatedState = newState.delayed(by: outputLatency)
+            if !playbackState.approximateEqual(to: compensatedState) {
+                playbackState = compensatedState
             }
             
-            let newTrack = info.track
-            if newTrack?.id != currentTrack?.id {
+            guard followsTrack else {
+                return
+            }
+            let newTrack = info.track(includingArtwork: interest.contains(.artwork))
+            if !currentTrack.isSameTrack(as: newTrack, policy: trackIdentityPolicy)
+                || !PlayerChanges(metadataFrom: currentTrack, to: newTrack, comparing: interest).isEmpty {
                 currentTrack = newTrack
             }
         }
         
         private func mediaRemoteNowPlayingApplicationPlaybackStateDidChange(n: Notification) {
             guard let info = n.userInfo as! [String: Any]? else {
+                reportedPlaybackState = .stopped
                 playbackState = .stopped
                 currentTrack = nil
                 return
@@ -85,6 +135,7 @@ extension MusicPlayers {
             if systemPlaybackState == .playing || systemPlaybackState == .paused {
                 updatePlayerState()
             } else {
+                reportedPlaybackState = .stopped
                 playbackState = .stopped
                 currentTrack = nil
             }
@@ -94,6 +145,44 @@ extension MusicPlayers {
             // TODO: extract track info from notification
             updatePlayerState()
         }
+        
+        private var followsTrack: Bool {
+            return !interest.isDisjoint(with: PlayerChanges.metadata.union(.track))
+        }
+        
+        private func updateInterest() {
+            let newInterest = baselineInterest.union(interests.union)
+            guard newInterest != interest else {
+                return
+            }
+            let isWider = !newInterest.isSubset(of: interest)
+            interest = newInterest
+            // A playback state notification reads the info anyway, which is
+            // enough for the state kind.
+            observeNowPlayingInfo(!interest.isDisjoint(with: PlayerChanges.all.subtracting(.stateKind)))
+            // What wasn't followed until now may be stale.
+            if isWider {
+                updatePlayerState()
+            }
+        }
+        
+        private func observeNowPlayingInfo(_ isObserved: Bool) {
+            if isObserved, infoObserver == nil {
+                infoObserver = NotificationCenter.default.addObserver(forName: .mediaRemoteNowPlayingInfoDidChange, object: nil, queue: nil) { [weak self] n in
+                    self?.mediaRemoteNowPlayingInfoDidChange(n: n)
+                }
+            } else if !isObserved, let observer = infoObserver {
+                NotificationCenter.default.removeObserver(observer)
+                infoObserver = nil
+            }
+        }
+    }
+}
+
+extension MusicPlayers.SystemMedia: PlayerInterestTracking {
+    
+    public func registerInterest(_ interest: PlayerChanges) -> AnyCancellable {
+        return interests.register(interest)
     }
 }
 
@@ -116,8 +205,13 @@ extension MusicPlayers.SystemMedia: MusicPlayerProtocol {
             return playbackState.time
         }
         set {
-            MRMediaRemoteSetElapsedTime_?(newValue)
-            playbackState = playbackState.withTime(newValue)
+            queue.async { [weak self] in
+                guard let self = self else { return }
+                let position = self.playbackState.isPlaying ? newValue + self.outputLatency : newValue
+                MRMediaRemoteSetElapsedTime_?(position)
+                self.reportedPlaybackState = self.reportedPlaybackState.withTime(position)
+                self.playbackState = self.playbackState.withTime(newValue)
+            }
         }
     }
     
@@ -142,10 +236,15 @@ extension MusicPlayers.SystemMedia: MusicPlayerProtocol {
     }
     
     public func updatePlayerState() {
-        MRMediaRemoteGetNowPlayingInfo_?(DispatchQueue.playerUpdate) { [weak self] info in
+        MRMediaRemoteGetNowPlayingInfo_?(queue) { [weak self] info in
             self?.getNowPlayingInfoCallback(info)
         }
     }
+    
+    /// On the queue of the player.
+    public func performInContext(_ body: @escaping () -> Void) {
+        queue.async(execute: body)
+    }
 }
 
 private extension MusicPlayers.SystemMedia {
@@ -0,0 +1,135 @@
+//
+//  TypedAgent.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+extension MusicPlayers {
+    
+    /// `Agent` for a single known player type.
+    ///
+    /// Reads and commands are forwarded without going through an existential,
+    /// and are inlinable, so the compiler can specialize them for `Player`.
+    /// `designatedPlayer` itself is still read through the class's vtable,
+    /// since subclasses like `TypedNowPlaying` override it. Only the call on
+    /// the player is specialized, and it's direct if `Player` is final.
+    open class TypedAgent<Player: MusicPlayerProtocol>: ObservableObject {
+        
+        @Published public var designatedPlayer: Player?
+        
+        public let objectWillChange = ObservableObjectPublisher()
+        
+        private var objectWillChangeCanceller: AnyCancellable?
+        private var interestCanceller: AnyCancellable?
+        private let interestForwarder = PlayerInterestForwarder()
+        
+        public init() {
+            objectWillChangeCanceller = $designatedPlayer
+                .map { $0?.objectWillChange.eraseToAnyPublisher() ?? Just(()).eraseToAnyPublisher() }
+                .switchToLatest()
+                .sink { [weak self] _ in self?.objectWillChange.send() }
+            interestCanceller = $designatedPlayer
+                .sink { [weak self] in self?.interestForwarder.forward(to: $0) }
+        }
+    }
+}
+
+extension MusicPlayers.TypedAgent: MusicPlayerProtocol {
+    
+    @inlinable
+    public var name: MusicPlayerName? {
+        return designatedPlayer?.name
+    }
+    
+    @inlinable
+    public var playerIdentifier: String {
+        return designatedPlayer?.playerIdentifier ?? ""
+    }
+    
+    @inlinable
+    public var currentTrack: MusicTrack? {
+        return designatedPlayer?.currentTrack
+    }
+    
+    @inlinable
+    public var playbackState: PlaybackState {
+        return designatedPlayer?.playbackState ?? .stopped
+    }
+    
+    @inlinable
+    public var trackIdentityPolicy: TrackIdentityPolicy {
+        return designatedPlayer?.trackIdentityPolicy ?? .backendID
+    }
+    
+    @inlinable
+    public var playbackTime: TimeInterval {
+        get { return designatedPlayer?.playbackTime ?? 0 }
+        set { designatedPlayer?.playbackTime = newValue }
+    }
+    
+    public var currentTrackWillChange: AnyPublisher<MusicTrack?, Never> {
+        return $designatedPlayer.map { $0?.currentTrackWillChange ?? Just(nil).eraseToAnyPublisher() }
+            .switchToLatest()
+            .eraseToAnyPublisher()
+    }
+    
+    public var playbackStateWillChange: AnyPublisher<PlaybackState, Never> {
+        return $designatedPlayer.map { $0?.playbackStateWillChange ?? Just(.stopped).eraseToAnyPublisher() }
+            .switchToLatest()
+            .eraseToAnyPublisher()
+    }
+    
+    @inlinable
+    public func resume() {
+        designatedPlayer?.resume()
+    }
+    
+    @inlinable
+    public func pause() {
+        designatedPlayer?.pause()
+    }
+    
+    @inlinable
+    public func playPause() {
+        designatedPlayer?.playPause()
+    }
+    
+    @inlinable
+    public func skipToNextItem() {
+        designatedPlayer?.skipToNextItem()
+    }
+    
+    @inlinable
+    public func skipToPreviousItem() {
+        designatedPlayer?.skipToPreviousItem()
+    }
+    
+    @inlinable
+    public func updatePlayerState() {
+        designatedPlayer?.updatePlayerState()
+    }
+    
+    /// In the context of the designated player.
+    @inlinable
+    public func performInContext(_ body: @escaping () -> Void) {
+        if let player = designatedPlayer {
+            player.performInContext(body)
+        } else {
+            body()
+        }
+    }
+}
+
+extension MusicPlayers.TypedAgent: PlayerInterestTracking {
+    
+    /// Registered with the designated player, whichever it is.
+    public func registerInterest(_ interest: PlayerChanges) -> AnyCancellable {
+        return interestForwarder.registry.register(interest)
+    }
+}
@@ -0,0 +1,70 @@
+//
+//  TypedNowPlaying.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+extension MusicPlayers {
+    
+    /// `NowPlaying` for players of a single known type, such as `MPRIS` on
+    /// Linux. `players` and `designatedPlayer` keep their type, and selection
+    /// doesn't go through existentials.
+    public class TypedNowPlaying<Player: MusicPlayerProtocol>: TypedAgent<Player> {
+        
+        override public var designatedPlayer: Player? {
+            get { return super.designatedPlayer }
+            set { preconditionFailure("setting currentPlayer for MusicPlayers.TypedNowPlaying is forbidden") }
+        }
+        
+        public var players: [Player] {
+            didSet {
+                selection.setPlayers(players)
+            }
+        }
+        
+        /// Decides which of `players` to follow.
+        public var selectionPolicy: PlayerSelectionPolicy {
+            get { return selection.policy }
+            set { selection.policy = newValue }
+        }
+        
+        /// How often the designated player changed.
+        public var selectionStatistics: PlayerSelectionStatistics {
+            return selection.statistics
+        }
+        
+        private let selection: PlayerSelectionLoop<Player>
+        
+        public init(players: [Player], selectionPolicy: PlayerSelectionPolicy = .default) {
+            self.players = players
+            self.selection = PlayerSelectionLoop(policy: selectionPolicy,
+                                                 identifier: { $0.playerIdentifier },
+                                                 changes: { $0.snapshots })
+            super.init()
+            selection.current = { [weak self] in self?.designatedPlayer }
+            selection.designate = { [weak self] in self?.designate($0) }
+            selection.setPlayers(players)
+        }
+        
+        public func resetSelectionStatistics() {
+            selection.resetStatistics()
+        }
+        
+        private func designate(_ player: Player?) {
+            super.designatedPlayer = player
+        }
+    }
+}
+
+extension MusicPlayers.TypedNowPlaying: PlayerSelecting {
+    
+    public func excludePlayers(matching identifier: String) -> AnyCancellable {
+        return selection.exclude(identifier)
+    }
+}
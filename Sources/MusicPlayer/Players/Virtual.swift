@@ -12,23 +12,186 @@ import CXShim
 
 extension MusicPlayers {
     
+    /// A player whose state is set by hand, or, with a queue, a simulated
+    /// player that advances through the queue on its own.
     open class Virtual: ObservableObject {
         
         @Published public var currentTrack: MusicTrack?
         @Published public var playbackState: PlaybackState
         
+        /// Tracks to play. Empty for a player that is only changed by hand.
+        public private(set) var queue: [MusicTrack] = []
+        
+        /// Index in `queue` of the current track.
+        public var queueIndex: Int? {
+            return orderIndex.map { order[$0] }
+        }
+        
+        public var repeatMode: RepeatMode = .off
+        
+        public var shuffleMode: ShuffleMode = .off {
+            didSet {
+                if shuffleMode != oldValue {
+                    reorder(keeping: queueIndex)
+                }
+            }
+        }
+        
+        /// Length of queued tracks without a duration.
+        public var defaultTrackDuration: TimeInterval = 180
+        
+        /// Drives the simulation. Published playback states are relative to
+        /// the real time they are published at.
+        public let clock: SimulationClock
+        
+        private var order: [Int] = []
+        private var orderIndex: Int?
+        private var random: SplitMix64
+        private var positionBase: TimeInterval = 0
+        private var positionUpdatedAt: TimeInterval = 0
+        private var trackEnd: AnyCancellable?
+        
         public init(track: MusicTrack? = nil, state: PlaybackState = .stopped) {
             currentTrack = track
             playbackState = state
+            clock = SystemSimulationClock.shared
+            random = SplitMix64(seed: 0)
         }
         
-        /* open */ private func stop() {
+        /// A simulated player, paused at the start of `queue`. Pass a
+        /// `ManualSimulationClock` to run faster than real time. The same
+        /// `seed` gives the same shuffle order.
+        ///
+        /// The clock advances the player from its scheduled actions, so use
+        /// the player only where they run: on the main queue with
+        /// `SystemSimulationClock.shared`, on the clock's `queue` with another
+        /// `SystemSimulationClock`, and on the thread that advances a
+        /// `ManualSimulationClock`.
+        public init(queue: [MusicTrack], clock: SimulationClock = SystemSimulationClock.shared, repeatMode: RepeatMode = .off, shuffleMode: ShuffleMode = .off, seed: UInt64 = 0) {
             currentTrack = nil
             playbackState = .stopped
+            self.clock = clock
+            self.repeatMode = repeatMode
+            self.shuffleMode = shuffleMode
+            random = SplitMix64(seed: seed)
+            setQueue(queue)
+        }
+        
+        /// Replaces the queue, and moves to `index`. Keeps playing if it was.
+        public func setQueue(_ tracks: [MusicTrack], startingAt index: Int = 0) {
+            let wasPlaying = playbackState.isPlaying
+            queue = tracks
+            guard queue.indices.contains(index) else {
+                order = []
+                stop()
+                return
+            }
+            reorder(keeping: index)
+            load(orderIndex: orderIndex!, playing: wasPlaying)
+        }
+        
+        private func stop() {
+            trackEnd = nil
+            orderIndex = nil
+            currentTrack = nil
+            playbackState = .stopped
+        }
+    }
+}
+
+// MARK: - Simulation
+
+extension MusicPlayers.Virtual {
+    
+    private var isSimulating: Bool {
+        return !queue.isEmpty
+    }
+    
+    private var position: TimeInterval {
+        guard playbackState.isPlaying else {
+            return positionBase
+        }
+        return positionBase + clock.now - positionUpdatedAt
+    }
+    
+    private var currentDuration: TimeInterval {
+        guard let duration = currentTrack?.duration, duration > 0 else {
+            return defaultTrackDuration
+        }
+        return duration
+    }
+    
+    private func load(orderIndex: Int, playing: Bool) {
+        self.orderIndex = orderIndex
+        currentTrack = queue[order[orderIndex]]
+        setPosition(0, playing: playing)
+    }
+    
+    private func setPosition(_ position: TimeInterval, playing: Bool) {
+        positionBase = max(0, min(currentDuration, position))
+        positionUpdatedAt = clock.now
+        playbackState = playing ? .playing(time: positionBase) : .paused(time: positionBase)
+        scheduleTrackEnd()
+    }
+    
+    private func scheduleTrackEnd() {
+        trackEnd = nil
+        guard playbackState.isPlaying else {
+            return
+        }
+        trackEnd = clock.schedule(after: currentDuration - position) { [weak self] in
+            self?.trackDidEnd()
+        }
+    }
+    
+    private func trackDidEnd() {
+        if repeatMode == .one, let orderIndex = orderIndex {
+            load(orderIndex: orderIndex, playing: true)
+        } else {
+            advance(by: 1, playing: true)
+        }
+    }
+    
+    /// Moves `offset` tracks in play order. Past the end, wraps around with
+    /// repeat all, and stops otherwise.
+    private func advance(by offset: Int, playing: Bool) {
+        guard let orderIndex = orderIndex else {
+            return
+        }
+        var next = orderIndex + offset
+        if !order.indices.contains(next) {
+            guard repeatMode == .all else {
+                if next < 0 {
+                    load(orderIndex: 0, playing: playing)
+                } else {
+                    stop()
+                }
+                return
+            }
+            if next >= order.count && shuffleMode.isEnabled {
+                // Each pass over the queue gets a new order.
+                order.shuffle(using: &random)
+            }
+            next = (next % order.count + order.count) % order.count
         }
+        load(orderIndex: next, playing: playing)
+    }
+    
+    /// Rebuilds the play order. `index` in `queue` goes first when shuffled.
+    private func reorder(keeping index: Int?) {
+        order = Array(queue.indices)
+        if shuffleMode.isEnabled {
+            order.shuffle(using: &random)
+            if let index = index, let position = order.firstIndex(of: index) {
+                order.swapAt(0, position)
+            }
+        }
+        orderIndex = index.flatMap { order.firstIndex(of: $0) }
     }
 }
 
+extension MusicPlayers.Virtual: PlaybackModeSettable {}
+
 extension MusicPlayers.Virtual: MusicPlayerProtocol {
     
     public var currentTrackWillChange: AnyPublisher<MusicTrack?, Never> {
@@ -45,32 +208,80 @@ extension MusicPlayers.Virtual: MusicPlayerProtocol {
     
     public var playbackTime: TimeInterval {
         get {
-            return playbackState.time
+            return isSimulating ? position : playbackState.time
         }
         set {
-            playbackState = playbackState.withTime(newValue)
+            if isSimulating {
+                guard orderIndex != nil else { return }
+                setPosition(newValue, playing: playbackState.isPlaying)
+            } else {
+                playbackState = playbackState.withTime(newValue)
+            }
         }
     }
     
     public func resume() {
-        if case let .paused(time: time) = playbackState {
+        if isSimulating {
+            if orderIndex == nil {
+                // The queue ran out, play it again.
+                reorder(keeping: nil)
+                load(orderIndex: 0, playing: true)
+            } else if !playbackState.isPlaying {
+                setPosition(position, playing: true)
+            }
+        } else if case let .paused(time: time) = playbackState {
             playbackState = .playing(time: time)
         }
     }
     
     public func pause() {
-        if playbackState.isPlaying {
+        if isSimulating {
+            if playbackState.isPlaying {
+                setPosition(position, playing: false)
+            }
+        } else if playbackState.isPlaying {
             playbackState = .paused(time: playbackState.time)
         }
     }
     
     public func skipToNextItem() {
-        stop()
+        if isSimulating {
+            advance(by: 1, playing: playbackState.isPlaying)
+        } else {
+            stop()
+        }
     }
     
     public func skipToPreviousItem() {
-        stop()
+        if isSimulating {
+            // Like most players, restart the track unless it just started.
+            if position > 3, let orderIndex = orderIndex {
+                load(orderIndex: orderIndex, playing: playbackState.isPlaying)
+            } else {
+                advance(by: -1, playing: playbackState.isPlaying)
+            }
+        } else {
+            stop()
+        }
     }
     
     public func updatePlayerState() {}
 }
+
+/// Small seedable generator, for reproducible shuffles.
+struct SplitMix64: RandomNumberGenerator {
+    
+    private var state: UInt64
+    
+    init(seed: UInt64) {
+        state = seed
+    }
+    
+    mutating func next() -> UInt64 {
+        state &+= 0x9E3779B97F4A7C15
+        var z = state
+        z = (z ^ (z >> 30)) &* 0xBF58476D1CE4E5B9
+        z = (z ^ (z >> 27)) &* 0x94D049BB133111EB
+        return z ^ (z >> 31)
+    }
+}
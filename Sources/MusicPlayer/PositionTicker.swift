@@ -0,0 +1,126 @@
+//
+//  PositionTicker.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// Publishes the position of a player at a fixed rate, for progress bars
+/// and karaoke highlights, from one timer shared by all subscribers.
+///
+/// Positions are extrapolated from the last playback state, so the player
+/// is never asked for its position. The timer only runs while the player
+/// plays and someone subscribes. A tick does no heap allocation.
+public final class PositionTicker {
+    
+    /// Ticks per second.
+    public let rate: Double
+    
+    /// Number of ticks sent so far.
+    public var tickCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return ticks
+    }
+    
+    private let subject = PassthroughSubject<TimeInterval, Never>()
+    private let queue = DispatchQueue.player("Ticker")
+    private let timer: DispatchSourceTimer
+    private let interval: DispatchTimeInterval
+    private let lock = NSLock()
+    private var state: PlaybackState = .stopped
+    private var subscriberCount = 0
+    private var isTimerRunning = false
+    private var ticks = 0
+    private var stateCanceller: AnyCancellable?
+    
+    public init(player: MusicPlayerProtocol, rate: Double) {
+        self.rate = rate
+        interval = .nanoseconds(Int(1_000_000_000 / max(1, rate)))
+        timer = DispatchSource.makeTimerSource(queue: queue)
+        timer.setEventHandler { [unowned self] in
+            self.tick()
+        }
+        stateCanceller = player.playbackStateWillChange.sink { [unowned self] state in
+            self.stateDidChange(to: state)
+        }
+    }
+    
+    deinit {
+        stateCanceller?.cancel()
+        timer.setEventHandler(handler: nil)
+        // A suspended source must not be released.
+        if !isTimerRunning {
+            timer.resume()
+        }
+        timer.cancel()
+    }
+    
+    /// Positions, starting with the current one for every subscriber. While
+    /// paused or stopped, only changes are sent.
+    public var positions: AnyPublisher<TimeInterval, Never> {
+        let subject = self.subject
+        return Deferred { [weak self] in
+            subject.prepend(self.map { [$0.position] } ?? [])
+        }
+        .handleEvents(receiveSubscription: { [weak self] _ in
+            self?.subscriberCountDidChange(by: 1)
+        }, receiveCancel: { [weak self] in
+            self?.subscriberCountDidChange(by: -1)
+        })
+        .eraseToAnyPublisher()
+    }
+    
+    private var position: TimeInterval {
+        lock.lock()
+        defer { lock.unlock() }
+        return state.time
+    }
+    
+    private func tick() {
+        lock.lock()
+        let position = state.time
+        ticks += 1
+        lock.unlock()
+        subject.send(position)
+    }
+    
+    private func stateDidChange(to newState: PlaybackState) {
+        lock.lock()
+        state = newState
+        lock.unlock()
+        updateTimer()
+        // The exact position where it stopped, or the new one after a seek.
+        queue.async { [weak self] in
+            self?.tick()
+        }
+    }
+    
+    private func subscriberCountDidChange(by delta: Int) {
+        lock.lock()
+        subscriberCount += delta
+        lock.unlock()
+        updateTimer()
+    }
+    
+    private func updateTimer() {
+        lock.lock()
+        defer { lock.unlock() }
+        let shouldRun = subscriberCount > 0 && state.isPlaying
+        guard shouldRun != isTimerRunning else {
+            return
+        }
+        isTimerRunning = shouldRun
+        if shouldRun {
+            timer.schedule(deadline: .now() + interval, repeating: interval, leeway: .milliseconds(1))
+            timer.resume()
+        } else {
+            timer.suspend()
+        }
+    }
+}
@@ -0,0 +1,173 @@
+//
+//  ScrubSession.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// Coalesces the seeks of a progress slider that is being dragged.
+///
+/// `seek(to:)` updates `playbackState` right away. Only the latest target
+/// is sent to the player, with at most one request in flight, so a slow
+/// player doesn't fall behind the user's hand. Requests go through
+/// `performInContext`, like the GLib main loop for MPRIS.
+/// `end(confirmation:)` waits for the last target to be sent and refreshes
+/// the player once.
+public final class ScrubSession: ObservableObject {
+    
+    public struct Statistics {
+        
+        /// Calls to `seek(to:)`.
+        public internal(set) var seeks = 0
+        
+        /// Positions actually sent to the player.
+        public internal(set) var sent = 0
+        
+        /// Round trips saved by coalescing.
+        public var saved: Int {
+            return seeks - sent
+        }
+    }
+    
+    public let player: MusicPlayerProtocol
+    
+    /// The player's state at the latest target, until the session ends.
+    @Published public private(set) var playbackState: PlaybackState
+    
+    public var statistics: Statistics {
+        lock.lock()
+        defer { lock.unlock() }
+        return _statistics
+    }
+    
+    public var isActive: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return _isActive
+    }
+    
+    private let queue = DispatchQueue.player("Scrub")
+    private let lock = NSLock()
+    private var _statistics = Statistics()
+    private var _isActive = true
+    private var pendingTarget: TimeInterval?
+    private var isSending = false
+    private var confirmation: ((PlaybackState) -> Void)?
+    private var confirmationCanceller: AnyCancellable?
+    
+    /// How long `end(confirmation:)` waits for the player to publish its
+    /// state before reading it.
+    static let confirmationTimeout: TimeInterval = 1
+    
+    public init(player: MusicPlayerProtocol) {
+        self.player = player
+        self.playbackState = player.playbackState
+    }
+    
+    public func seek(to time: TimeInterval) {
+        lock.lock()
+        guard _isActive else {
+            lock.unlock()
+            return
+        }
+        _statistics.seeks += 1
+        pendingTarget = time
+        let needsSender = !isSending
+        isSending = true
+        lock.unlock()
+        
+        playbackState = playbackState.withTime(time)
+        if needsSender {
+            queue.async(execute: sendPendingTargets)
+        }
+    }
+    
+    /// Ends the session. Once the last target reached the player, it's
+    /// refreshed, and `confirmation` gets the state it publishes next.
+    public func end(confirmation: ((PlaybackState) -> Void)? = nil) {
+        lock.lock()
+        guard _isActive else {
+            lock.unlock()
+            return
+        }
+        _isActive = false
+        self.confirmation = confirmation
+        let isIdle = !isSending
+        lock.unlock()
+        // Otherwise the sender confirms after the last target.
+        if isIdle {
+            queue.async(execute: confirm)
+        }
+    }
+    
+    private func sendPendingTargets() {
+        lock.lock()
+        guard let target = pendingTarget else {
+            isSending = false
+            let isEnded = !_isActive
+            lock.unlock()
+            if isEnded {
+                confirm()
+            }
+            return
+        }
+        pendingTarget = nil
+        _statistics.sent += 1
+        lock.unlock()
+        // Seeks that arrive meanwhile replace each other, and are sent once
+        // this one is done.
+        let player = self.player
+        player.performInContext {
+            player.playbackTime = target
+            self.queue.async(execute: self.sendPendingTargets)
+        }
+    }
+    
+    private func confirm() {
+        lock.lock()
+        if confirmation != nil {
+            // The first value is the state from before the refresh.
+            confirmationCanceller = player.playbackStateWillChange
+                .dropFirst()
+                .first()
+                .sink { state in
+                    self.finishConfirmation(with: state)
+                }
+            // Some players don't publish a state that didn't change.
+            queue.asyncAfter(deadline: .now() + ScrubSession.confirmationTimeout) {
+                let player = self.player
+                player.performInContext {
+                    self.finishConfirmation(with: player.playbackState)
+                }
+            }
+        }
+        lock.unlock()
+        let player = self.player
+        player.performInContext {
+            player.updatePlayerState()
+        }
+    }
+    
+    private func finishConfirmation(with state: PlaybackState) {
+        lock.lock()
+        let confirmation = self.confirmation
+        self.confirmation = nil
+        confirmationCanceller = nil
+        lock.unlock()
+        confirmation?(state)
+    }
+}
+
+extension MusicPlayerProtocol {
+    
+    /// Starts coalescing seeks, for example while a progress slider is
+    /// dragged.
+    public func beginScrubbing() -> ScrubSession {
+        return ScrubSession(player: self)
+    }
+}
@@ -0,0 +1,162 @@
+//
+//  TrackIdentity.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+/// Decides whether two tracks reported by a backend are the same track.
+public struct TrackIdentityPolicy {
+    
+    public enum Mode {
+        /// Only compare backend ids.
+        case backendID
+        /// Ignore backend ids, compare URL and normalized metadata.
+        case content
+        /// Trust backend ids unless one of them is a placeholder, and
+        /// compare content only then.
+        case automatic
+    }
+    
+    public var mode: Mode
+    
+    /// Durations closer than this are considered equal.
+    public var durationTolerance: TimeInterval
+    
+    /// Ids that don't identify anything.
+    public var placeholderIDs: Set<String>
+    
+    public init(mode: Mode, durationTolerance: TimeInterval = 2, placeholderIDs: Set<String> = TrackIdentityPolicy.commonPlaceholderIDs) {
+        self.mode = mode
+        self.durationTolerance = durationTolerance
+        self.placeholderIDs = placeholderIDs
+    }
+    
+    public static let commonPlaceholderIDs: Set<String> = ["", "/", "/org/mpris/MediaPlayer2/TrackList/NoTrack"]
+    
+    public static let backendID = TrackIdentityPolicy(mode: .backendID)
+    public static let content = TrackIdentityPolicy(mode: .content)
+    public static let automatic = TrackIdentityPolicy(mode: .automatic)
+}
+
+/// Content-based identity of a track: URL, normalized title, artist and
+/// album, and duration.
+public struct TrackFingerprint: Hashable {
+    
+    public let url: String?
+    
+    /// Stable hash of the normalized title, artist and album. Zero if the
+    /// track has none of them.
+    public let contentHash: UInt64
+    
+    public let duration: TimeInterval?
+    
+    public init(track: MusicTrack) {
+        url = track.fileURL?.absoluteString
+        duration = track.duration.flatMap { $0 > 0 ? $0 : nil }
+        if track.title == nil && track.artist == nil && track.album == nil {
+            contentHash = 0
+        } else {
+            var hasher = StableHasher()
+            hasher.combine(TrackFingerprint.normalize(track.title))
+            hasher.combine(TrackFingerprint.normalize(track.artist))
+            hasher.combine(TrackFingerprint.normalize(track.album))
+            contentHash = hasher.value
+        }
+    }
+    
+    var isEmpty: Bool {
+        return url == nil && contentHash == 0
+    }
+    
+    /// Different URLs always mean different tracks. Otherwise metadata
+    /// decides, so a stream that keeps its URL still changes tracks. The URL
+    /// alone is used only when there is no metadata to compare.
+    public func matches(_ other: TrackFingerprint, durationTolerance: TimeInterval) -> Bool {
+        if let url = url, let otherURL = other.url, url != otherURL {
+            return false
+        }
+        guard contentHash != 0, other.contentHash != 0 else {
+            return url != nil && url == other.url
+        }
+        guard contentHash == other.contentHash else {
+            return false
+        }
+        if let duration = duration, let otherDuration = other.duration {
+            return abs(duration - otherDuration) <= durationTolerance
+        }
+        return true
+    }
+    
+    /// Case, width and diacritic folded, with whitespace collapsed.
+    static func normalize(_ string: String?) -> String {
+        guard let string = string else {
+            return ""
+        }
+        let folded: String
+        if string.utf8.allSatisfy({ $0 < 0x80 }) {
+            folded = string.lowercased()
+        } else {
+            folded = string.folding(options: [.caseInsensitive, .diacriticInsensitive, .widthInsensitive], locale: nil)
+        }
+        return folded.split(whereSeparator: { $0.isWhitespace }).joined(separator: " ")
+    }
+}
+
+/// The fingerprint of a track, once computed.
+final class TrackFingerprintCache {
+    
+    private let lock = NSLock()
+    private var fingerprint: TrackFingerprint?
+    
+    func value(_ make: () -> TrackFingerprint) -> TrackFingerprint {
+        lock.lock()
+        defer { lock.unlock() }
+        if let fingerprint = fingerprint {
+            return fingerprint
+        }
+        let value = make()
+        fingerprint = value
+        return value
+    }
+}
+
+extension MusicTrack {
+    
+    /// Whether `other` is the same track under `policy`. Content is only
+    /// looked at when the backend ids can't decide.
+    public func isSameTrack(as other: MusicTrack, policy: TrackIdentityPolicy) -> Bool {
+        let isIDUsable = !policy.placeholderIDs.contains(id) && !policy.placeholderIDs.contains(other.id)
+        switch policy.mode {
+        case .backendID:
+            return id == other.id
+        case .automatic where isIDUsable:
+            return id == other.id
+        case .automatic, .content:
+            let fingerprint = self.fingerprint
+            let otherFingerprint = other.fingerprint
+            if fingerprint.isEmpty && otherFingerprint.isEmpty {
+                return id == other.id
+            }
+            return fingerprint.matches(otherFingerprint, durationTolerance: policy.durationTolerance)
+        }
+    }
+}
+
+extension Optional where Wrapped == MusicTrack {
+    
+    func isSameTrack(as other: MusicTrack?, policy: TrackIdentityPolicy) -> Bool {
+        switch (self, other) {
+        case (nil, nil):
+            return true
+        case let (track?, other?):
+            return track.isSameTrack(as: other, policy: policy)
+        default:
+            return false
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//
+//  CircuitBreaker.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+/// Bounds the calls made to a player that may stop answering, like a frozen
+/// app whose bus connection is still open.
+public struct CallTimeoutPolicy {
+    
+    /// Longest wait for a single call.
+    public var timeout: TimeInterval
+    
+    /// Timeouts in a row before the player is marked degraded and left alone.
+    public var timeoutsBeforeDegrading: Int
+    
+    /// Delay before a degraded player is probed again.
+    public var probeInterval: TimeInterval
+    
+    /// Upper bound of the delay, which doubles after each failed probe.
+    public var maximumProbeInterval: TimeInterval
+    
+    public init(timeout: TimeInterval = 0.25, timeoutsBeforeDegrading: Int = 2, probeInterval: TimeInterval = 2, maximumProbeInterval: TimeInterval = 60) {
+        self.timeout = timeout
+        self.timeoutsBeforeDegrading = max(1, timeoutsBeforeDegrading)
+        self.probeInterval = probeInterval
+        self.maximumProbeInterval = max(probeInterval, maximumProbeInterval)
+    }
+    
+    public static var `default` = CallTimeoutPolicy()
+}
+
+/// Counts the timeouts of a single player and decides whether it may still
+/// be called.
+struct CircuitBreaker {
+    
+    var policy: CallTimeoutPolicy
+    
+    /// No calls but probes are made while open.
+    private(set) var isOpen = false
+    private(set) var consecutiveTimeouts = 0
+    private(set) var probeInterval: TimeInterval
+    
+    init(policy: CallTimeoutPolicy) {
+        self.policy = policy
+        self.probeInterval = policy.probeInterval
+    }
+    
+    /// Records an answered call or probe, which closes the breaker.
+    mutating func recordSuccess() {
+        isOpen = false
+        consecutiveTimeouts = 0
+        probeInterval = policy.probeInterval
+    }
+    
+    /// Records a call that timed out. Returns whether it opened the breaker.
+    mutating func recordTimeout() -> Bool {
+        consecutiveTimeouts += 1
+        guard !isOpen, consecutiveTimeouts >= policy.timeoutsBeforeDegrading else {
+            return false
+        }
+        isOpen = true
+        return true
+    }
+    
+    mutating func recordFailedProbe() {
+        probeInterval = min(probeInterval * 2, policy.maximumProbeInterval)
+    }
+}
@@ -69,4 +69,57 @@ extension GRunLoop {
     }
 }
 
+/// Runs `body` on the default main context: right away if this thread owns
+/// it, or else on its next iteration. Safe to call from any thread.
+func gMainContextInvoke(_ body: @escaping () -> Void) {
+    let onInvoke: @convention(c) (gpointer?) -> gboolean = { data in
+        Unmanaged<GInvocation>.fromOpaque(data!).takeRetainedValue().body()
+        return 0 // G_SOURCE_REMOVE
+    }
+    g_main_context_invoke(nil, onInvoke, Unmanaged.passRetained(GInvocation(body)).toOpaque())
+}
+
+private final class GInvocation {
+    
+    let body: () -> Void
+    
+    init(_ body: @escaping () -> Void) {
+        self.body = body
+    }
+}
+
+/// One-shot timeout on the default main context. Cancelled on deinit.
+final class GTimeout {
+    
+    private var sourceID: guint = 0
+    private let handler: () -> Void
+    
+    init(after interval: TimeInterval, handler: @escaping () -> Void) {
+        self.handler = handler
+        let onTimeout: @convention(c) (gpointer?) -> gboolean = { data in
+            let timeout = data!.unretainedCast(to: GTimeout.self)
+            timeout.sourceID = 0
+            timeout.handler()
+            return 0 // G_SOURCE_REMOVE
+        }
+        let milliseconds = guint(max(0, (interval * 1000).rounded(.up)))
+        sourceID = g_timeout_add(milliseconds, onTimeout, Unmanaged.passUnretained(self).toOpaque())
+    }
+    
+    var isPending: Bool {
+        return sourceID != 0
+    }
+    
+    func cancel() {
+        if sourceID != 0 {
+            g_source_remove(sourceID)
+            sourceID = 0
+        }
+    }
+    
+    deinit {
+        cancel()
+    }
+}
+
 #endif
@@ -11,5 +11,15 @@ import Dispatch
 
 extension DispatchQueue {
     
+    /// Work that spans players, such as `NowPlaying` selection.
     static let playerUpdate = DispatchQueue(label: "ddddxxx.LyricsX.MusicPlayer.Update")
+    
+    /// Where the queues of single players run, in parallel with each other.
+    static let playerPool = DispatchQueue(label: "ddddxxx.LyricsX.MusicPlayer.Pool", attributes: .concurrent)
+    
+    /// A serial queue for the work of one player, so that a slow player
+    /// only delays itself.
+    static func player(_ name: String) -> DispatchQueue {
+        return DispatchQueue(label: "ddddxxx.LyricsX.MusicPlayer.Update.\(name)", target: playerPool)
+    }
 }
@@ -0,0 +1,137 @@
+//
+//  LatestValueSink.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// A subscriber that receives values on its own queue and, when it falls
+/// behind, skips to the latest value.
+///
+/// All subscribers of a player run on the queue it publishes on, so a
+/// plain `sink` that is slow, say one that writes to disk, delays every
+/// other subscriber. This one only stores the value on the publishing
+/// queue, so nobody waits for it. A value that arrives before the previous
+/// one is delivered replaces it.
+public final class LatestValueSink<Input>: Cancellable {
+    
+    public struct Statistics {
+        /// Values sent by the publisher.
+        public var received = 0
+        /// Values given to `receiveValue`.
+        public var delivered = 0
+        /// Values replaced by a newer one before delivery.
+        public var dropped = 0
+        /// Longest time from the arrival of a value, or of the first value it
+        /// replaced, to its delivery.
+        public var maximumLag: TimeInterval = 0
+        /// Sum of the lag of all delivered values.
+        public var totalLag: TimeInterval = 0
+        
+        public var averageLag: TimeInterval {
+            return delivered > 0 ? totalLag / Double(delivered) : 0
+        }
+    }
+    
+    public let queue: DispatchQueue
+    
+    private let receiveValue: (Input) -> Void
+    private let lock = NSLock()
+    private var pending: (value: Input, since: UInt64)?
+    private var isDraining = false
+    private var _statistics = Statistics()
+    private var upstream: AnyCancellable?
+    
+    /// Subscribes to `publisher`. `receiveValue` runs on `queue`, a new
+    /// serial queue by default.
+    public init<P: Publisher>(_ publisher: P, queue: DispatchQueue? = nil, receiveValue: @escaping (Input) -> Void) where P.Output == Input, P.Failure == Never {
+        self.queue = queue ?? DispatchQueue(label: "ddddxxx.LyricsX.MusicPlayer.LatestValueSink")
+        self.receiveValue = receiveValue
+        upstream = publisher.sink { [weak self] value in
+            self?.receive(value)
+        }
+    }
+    
+    deinit {
+        cancel()
+    }
+    
+    public var statistics: Statistics {
+        lock.lock()
+        defer { lock.unlock() }
+        return _statistics
+    }
+    
+    /// How long the value waiting for delivery has waited, zero if none.
+    public var lag: TimeInterval {
+        lock.lock()
+        defer { lock.unlock() }
+        return pending.map { TimeInterval(DispatchTime.now().uptimeNanoseconds &- $0.since) / 1_000_000_000 } ?? 0
+    }
+    
+    public func resetStatistics() {
+        lock.lock()
+        _statistics = Statistics()
+        lock.unlock()
+    }
+    
+    public func cancel() {
+        upstream?.cancel()
+        upstream = nil
+        lock.lock()
+        pending = nil
+        lock.unlock()
+    }
+    
+    private func receive(_ value: Input) {
+        lock.lock()
+        _statistics.received += 1
+        if let replaced = pending {
+            _statistics.dropped += 1
+            pending = (value, replaced.since)
+        } else {
+            pending = (value, DispatchTime.now().uptimeNanoseconds)
+        }
+        let needsDrain = !isDraining
+        isDraining = true
+        lock.unlock()
+        if needsDrain {
+            queue.async { [weak self] in
+                self?.drain()
+            }
+        }
+    }
+    
+    private func drain() {
+        while true {
+            lock.lock()
+            guard let next = pending else {
+                isDraining = false
+                lock.unlock()
+                return
+            }
+            pending = nil
+            let lag = TimeInterval(DispatchTime.now().uptimeNanoseconds &- next.since) / 1_000_000_000
+            _statistics.delivered += 1
+            _statistics.totalLag += lag
+            _statistics.maximumLag = max(_statistics.maximumLag, lag)
+            lock.unlock()
+            receiveValue(next.value)
+        }
+    }
+}
+
+extension Publisher where Failure == Never {
+    
+    /// Like `sink(receiveValue:)`, but a slow `receiveValue` skips to the
+    /// latest value instead of holding up the publisher. See
+    /// `LatestValueSink`.
+    public func sinkLatest(on queue: DispatchQueue? = nil, receiveValue: @escaping (Output) -> Void) -> LatestValueSink<Output> {
+        return LatestValueSink(self, queue: queue, receiveValue: receiveValue)
+    }
+}
@@ -0,0 +1,287 @@
+//
+//  MPRISMetadata.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if os(Linux)
+
+import Foundation
+import playerctl
+
+/// The full MPRIS metadata map of a track, as sent by the player.
+///
+/// Keeps a reference to the original `a{sv}` `GVariant` instead of copying
+/// it. A field is only decoded when it's asked for, and decoded once.
+public final class MPRISMetadata {
+    
+    private let variant: OpaquePointer /* GVariant* */
+    
+    private let lock = NSLock()
+    private var cache: [CacheKey: Any] = [:]
+    
+    private struct CacheKey: Hashable {
+        let key: String
+        let type: ObjectIdentifier
+    }
+    
+    /// Takes over one reference to `variant`.
+    init(variant: OpaquePointer) {
+        self.variant = variant
+    }
+    
+    /// Wraps an `a{sv}` map, such as the `Metadata` property of a player,
+    /// and keeps a new reference to it.
+    public convenience init(retaining variant: OpaquePointer) {
+        self.init(variant: g_variant_ref(variant))
+    }
+    
+    deinit {
+        g_variant_unref(variant)
+    }
+    
+    /// All keys in the map.
+    public var keys: [String] {
+        var result: [String] = []
+        let count = g_variant_n_children(variant)
+        result.reserveCapacity(Int(count))
+        for i in 0..<count {
+            let entry = g_variant_get_child_value(variant, i)!
+            let key = g_variant_get_child_value(entry, 0)!
+            result.append(String(cString: g_variant_get_string(key, nil)))
+            g_variant_unref(key)
+            g_variant_unref(entry)
+        }
+        return result
+    }
+    
+    /// Calls `body` with the raw value for `key`, without copying it.
+    public func withValue<R>(forKey key: String, _ body: (OpaquePointer? /* GVariant* */) throws -> R) rethrows -> R {
+        let value = g_variant_lookup_value(variant, key, nil)
+        defer {
+            if let value = value {
+                g_variant_unref(value)
+            }
+        }
+        return try body(value)
+    }
+    
+    public func string(forKey key: String) -> String? {
+        return cached(key) { withValue(forKey: key, MPRISMetadata.decodeString) }
+    }
+    
+    /// Values of type `as`. A single string is returned as one element.
+    public func strings(forKey key: String) -> [String]? {
+        return cached(key) { withValue(forKey: key, MPRISMetadata.decodeStrings) }
+    }
+    
+    public func integer(forKey key: String) -> Int? {
+        return cached(key) { withValue(forKey: key, MPRISMetadata.decodeInteger) }
+    }
+    
+    public func double(forKey key: String) -> Double? {
+        return cached(key) { withValue(forKey: key, MPRISMetadata.decodeDouble) }
+    }
+    
+    private func cached<T>(_ key: String, _ decode: () -> T?) -> T? {
+        let cacheKey = CacheKey(key: key, type: ObjectIdentifier(T.self))
+        lock.lock()
+        if let value = cache[cacheKey] {
+            lock.unlock()
+            return value as? T
+        }
+        lock.unlock()
+        let value = decode()
+        lock.lock()
+        cache[cacheKey] = value as Any
+        lock.unlock()
+        return value
+    }
+}
+
+// MARK: - Well-known Fields
+
+extension MPRISMetadata {
+    
+    public var trackID: String? {
+        return string(forKey: "mpris:trackid")
+    }
+    
+    /// `mpris:length`, in seconds.
+    public var length: TimeInterval? {
+        return integer(forKey: "mpris:length").map { TimeInterval($0) / 1_000_000 }
+    }
+    
+    public var artURL: URL? {
+        return string(forKey: "mpris:artUrl").flatMap(URL.init(string:))
+    }
+    
+    public var url: URL? {
+        return string(forKey: "xesam:url").flatMap(URL.init(string:))
+    }
+    
+    public var title: String? {
+        return string(forKey: "xesam:title")
+    }
+    
+    public var album: String? {
+        return string(forKey: "xesam:album")
+    }
+    
+    public var artists: [String]? {
+        return strings(forKey: "xesam:artist")
+    }
+    
+    public var albumArtists: [String]? {
+        return strings(forKey: "xesam:albumArtist")
+    }
+    
+    public var composers: [String]? {
+        return strings(forKey: "xesam:composer")
+    }
+    
+    public var genres: [String]? {
+        return strings(forKey: "xesam:genre")
+    }
+    
+    public var trackNumber: Int? {
+        return integer(forKey: "xesam:trackNumber")
+    }
+    
+    public var discNumber: Int? {
+        return integer(forKey: "xesam:discNumber")
+    }
+    
+    /// `xesam:asText`, usually the lyrics.
+    public var asText: String? {
+        return string(forKey: "xesam:asText")
+    }
+    
+    public var userRating: Double? {
+        return double(forKey: "xesam:userRating")
+    }
+}
+
+extension MPRISMetadata: MusicTrackFieldSource {
+    
+    var artist: String? {
+        return artists.map { $0.joined(separator: ", ") }
+    }
+    
+    var duration: TimeInterval? {
+        return length
+    }
+    
+    var fileURL: URL? {
+        return url
+    }
+    
+    var artwork: Image? {
+        return artURL
+    }
+}
+
+extension MusicTrack {
+    
+    /// The full metadata map, for tracks from `MusicPlayers.MPRIS`.
+    public var mprisMetadata: MPRISMetadata? {
+        return originalTrack as? MPRISMetadata
+    }
+    
+    /// A track that decodes its fields from `metadata` on first access.
+    /// Fails if there's no `mpris:trackid`.
+    public init?(mprisMetadata metadata: MPRISMetadata) {
+        guard let id = metadata.trackID else {
+            return nil
+        }
+        self.init(id: id, fieldSource: metadata, originalTrack: metadata)
+    }
+}
+
+// MARK: - Decoding
+
+private extension MPRISMetadata {
+    
+    static func unboxed(_ value: OpaquePointer) -> OpaquePointer {
+        // Players sometimes wrap values in an extra variant.
+        if g_variant_classify(value) == G_VARIANT_CLASS_VARIANT {
+            return g_variant_get_variant(value)!
+        }
+        return g_variant_ref(value)!
+    }
+    
+    static func decodeString(_ value: OpaquePointer?) -> String? {
+        guard let value = value.map(unboxed) else {
+            return nil
+        }
+        defer { g_variant_unref(value) }
+        switch g_variant_classify(value) {
+        case G_VARIANT_CLASS_STRING, G_VARIANT_CLASS_OBJECT_PATH:
+            return String(cString: g_variant_get_string(value, nil))
+        case G_VARIANT_CLASS_ARRAY:
+            return decodeStrings(value)?.first
+        default:
+            return nil
+        }
+    }
+    
+    static func decodeStrings(_ value: OpaquePointer?) -> [String]? {
+        guard let value = value.map(unboxed) else {
+            return nil
+        }
+        defer { g_variant_unref(value) }
+        switch g_variant_classify(value) {
+        case G_VARIANT_CLASS_STRING:
+            return [String(cString: g_variant_get_string(value, nil))]
+        case G_VARIANT_CLASS_ARRAY:
+            let count = g_variant_n_children(value)
+            var result: [String] = []
+            result.reserveCapacity(Int(count))
+            for i in 0..<count {
+                let child = g_variant_get_child_value(value, i)!
+                if g_variant_classify(child) == G_VARIANT_CLASS_STRING {
+                    result.append(String(cString: g_variant_get_string(child, nil)))
+                }
+                g_variant_unref(child)
+            }
+            return result
+        default:
+            return nil
+        }
+    }
+    
+    static func decodeInteger(_ value: OpaquePointer?) -> Int? {
+        guard let value = value.map(unboxed) else {
+            return nil
+        }
+        defer { g_variant_unref(value) }
+        switch g_variant_classify(value) {
+        case G_VARIANT_CLASS_INT16:     return Int(g_variant_get_int16(value))
+        case G_VARIANT_CLASS_UINT16:    return Int(g_variant_get_uint16(value))
+        case G_VARIANT_CLASS_INT32:     return Int(g_variant_get_int32(value))
+        case G_VARIANT_CLASS_UINT32:    return Int(g_variant_get_uint32(value))
+        case G_VARIANT_CLASS_INT64:     return Int(g_variant_get_int64(value))
+        case G_VARIANT_CLASS_UINT64:    return Int(clamping: g_variant_get_uint64(value))
+        case G_VARIANT_CLASS_DOUBLE:    return Int(exactly: g_variant_get_double(value).rounded())
+        default:                        return nil
+        }
+    }
+    
+    static func decodeDouble(_ value: OpaquePointer?) -> Double? {
+        guard let value = value.map(unboxed) else {
+            return nil
+        }
+        defer { g_variant_unref(value) }
+        switch g_variant_classify(value) {
+        case G_VARIANT_CLASS_DOUBLE:
+            return g_variant_get_double(value)
+        default:
+            return decodeInteger(value).map(Double.init)
+        }
+    }
+}
+
+#endif
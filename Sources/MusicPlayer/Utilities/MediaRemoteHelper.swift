@@ -88,11 +88,13 @@ struct MRNowPlayingInfo {
         return Image(data: artworkData)
     }
     
-    var track: MusicTrack? {
+    /// Artwork is decoded into an image right away, so it can be left out.
+    func track(includingArtwork: Bool = true) -> MusicTrack? {
         guard let id = id else {
             return nil
         }
-        return MusicTrack(id: id, title: _title, album: _album, artist: _artist, duration: _duration, fileURL: nil, artwork: artwork, originalTrack: nil)
+        return MusicTrack(id: id, title: _title, album: _album, artist: _artist, duration: _duration, fileURL: nil,
+                          artwork: includingArtwork ? artwork : nil, originalTrack: nil)
     }
 }
 
@@ -0,0 +1,200 @@
+//
+//  SignalHealth.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+/// Controls the polling fallback for players whose change signals can't be
+/// trusted. Players that deliver their signals are never polled.
+public struct PollingPolicy {
+    
+    /// Polling interval right after a change was detected.
+    public var minimumInterval: TimeInterval
+    
+    /// Upper bound of the interval while the state stays stable.
+    public var maximumInterval: TimeInterval
+    
+    /// Factor applied to the interval after each poll that found nothing new.
+    public var backoffMultiplier: Double
+    
+    /// How long a signal may lag behind the change it announces.
+    public var signalGracePeriod: TimeInterval
+    
+    /// Missing or late signals tolerated before polling is turned on.
+    public var strikesBeforePolling: Int
+    
+    /// On-time signals in a row that take back one strike, so that a signal
+    /// delayed once under load doesn't mean polling forever.
+    public var onTimeSignalsPerStrike: Int
+    
+    public init(minimumInterval: TimeInterval = 1, maximumInterval: TimeInterval = 30, backoffMultiplier: Double = 2, signalGracePeriod: TimeInterval = 1, strikesBeforePolling: Int = 2, onTimeSignalsPerStrike: Int = 10) {
+        self.minimumInterval = minimumInterval
+        self.maximumInterval = max(minimumInterval, maximumInterval)
+        self.backoffMultiplier = max(1, backoffMultiplier)
+        self.signalGracePeriod = signalGracePeriod
+        self.strikesBeforePolling = strikesBeforePolling
+        self.onTimeSignalsPerStrike = max(1, onTimeSignalsPerStrike)
+    }
+    
+    public static var `default` = PollingPolicy()
+    
+    /// Polls allowed per second across all players.
+    public static var globalPollBudget: Double {
+        get { return PollBudget.shared.rate }
+        set { PollBudget.shared.rate = newValue }
+    }
+}
+
+/// Watches the refreshes of a single player and decides whether it needs to
+/// be polled.
+struct SignalHealthMonitor {
+    
+    enum Trigger {
+        case initial
+        case playbackStatusSignal
+        case seekedSignal
+        case metadataSignal
+        case poll
+        case explicit
+    }
+    
+    enum Signal {
+        case seeked
+        case metadata
+    }
+    
+    /// Can be changed at any time. Strikes and the signal history are kept,
+    /// and the interval is moved into the new range.
+    var policy: PollingPolicy {
+        didSet {
+            pollInterval = min(max(pollInterval, policy.minimumInterval), policy.maximumInterval)
+        }
+    }
+    
+    private(set) var strikes = 0
+    private(set) var pollInterval: TimeInterval
+    
+    /// On-time signals since the last strike was counted or taken back.
+    private var onTimeSignals = 0
+    
+    private var lastSeeked: TimeInterval = -.infinity
+    private var lastMetadata: TimeInterval = -.infinity
+    
+    init(policy: PollingPolicy) {
+        self.policy = policy
+        self.pollInterval = policy.minimumInterval
+    }
+    
+    var needsPolling: Bool {
+        return strikes >= policy.strikesBeforePolling
+    }
+    
+    /// Records a refresh. Returns the signal that should have announced the
+    /// observed change but hasn't arrived yet.
+    mutating func observe(_ trigger: Trigger, trackChanged: Bool, positionJumped: Bool, at now: TimeInterval) -> Signal? {
+        switch trigger {
+        case .seekedSignal:     lastSeeked = now
+        case .metadataSignal:   lastMetadata = now
+        default:                break
+        }
+        if trackChanged || positionJumped {
+            pollInterval = policy.minimumInterval
+        } else if trigger == .poll {
+            pollInterval = min(pollInterval * policy.backoffMultiplier, policy.maximumInterval)
+        }
+        guard trigger != .initial else {
+            return nil
+        }
+        // The signal brought the change itself.
+        if (trackChanged && trigger == .metadataSignal) || (positionJumped && trigger == .seekedSignal) {
+            recordOnTimeSignal()
+        }
+        if trackChanged, trigger != .metadataSignal, now - lastMetadata > policy.signalGracePeriod {
+            return .metadata
+        }
+        if positionJumped, trigger != .seekedSignal, now - lastSeeked > policy.signalGracePeriod {
+            return .seeked
+        }
+        return nil
+    }
+    
+    /// Called once the grace period for a suspected signal is over. Counts a
+    /// strike if the signal didn't show up after `since`.
+    mutating func confirm(_ signal: Signal, since: TimeInterval) {
+        let last = signal == .seeked ? lastSeeked : lastMetadata
+        if last < since {
+            strikes += 1
+            onTimeSignals = 0
+        } else {
+            recordOnTimeSignal()
+        }
+    }
+    
+    private mutating func recordOnTimeSignal() {
+        guard strikes > 0 else {
+            return
+        }
+        onTimeSignals += 1
+        if onTimeSignals >= policy.onTimeSignalsPerStrike {
+            strikes -= 1
+            onTimeSignals = 0
+        }
+    }
+}
+
+/// Token bucket shared by all polling players.
+final class PollBudget {
+    
+    static let shared = PollBudget(rate: 20)
+    
+    private let lock = NSLock()
+    private var tokens: Double
+    private var lastRefill = ProcessInfo.processInfo.systemUptime
+    
+    private var _rate: Double
+    
+    var rate: Double {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return _rate
+        }
+        set {
+            lock.lock()
+            _rate = max(0, newValue)
+            tokens = min(tokens, _rate)
+            lock.unlock()
+        }
+    }
+    
+    init(rate: Double) {
+        _rate = rate
+        tokens = rate
+    }
+    
+    /// Takes one poll from the budget. Returns `false` if the budget for the
+    /// current second is used up.
+    func acquire() -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        let now = ProcessInfo.processInfo.systemUptime
+        tokens = min(_rate, tokens + (now - lastRefill) * _rate)
+        lastRefill = now
+        guard tokens >= 1 else {
+            return false
+        }
+        tokens -= 1
+        return true
+    }
+    
+    /// Time until the next poll is likely to be granted.
+    var retryInterval: TimeInterval {
+        let rate = self.rate
+        return rate > 0 ? 1 / rate : 1
+    }
+}
@@ -0,0 +1,123 @@
+//
+//  SimulationClock.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+
+/// Time source of a simulated player.
+public protocol SimulationClock: AnyObject {
+    
+    /// Seconds since an arbitrary origin. Never goes back.
+    var now: TimeInterval { get }
+    
+    /// Calls `action` once, `delay` seconds from `now`, unless cancelled.
+    func schedule(after delay: TimeInterval, _ action: @escaping () -> Void) -> AnyCancellable
+}
+
+/// Real time. Actions run on `queue`, so a simulated player must only be
+/// used there too.
+public final class SystemSimulationClock: SimulationClock {
+    
+    /// Runs actions on the main queue.
+    public static let shared = SystemSimulationClock()
+    
+    public let queue: DispatchQueue
+    
+    public init(queue: DispatchQueue = .main) {
+        self.queue = queue
+    }
+    
+    public var now: TimeInterval {
+        return ProcessInfo.processInfo.systemUptime
+    }
+    
+    public func schedule(after delay: TimeInterval, _ action: @escaping () -> Void) -> AnyCancellable {
+        let item = DispatchWorkItem(block: action)
+        queue.asyncAfter(deadline: .now() + max(0, delay), execute: item)
+        return AnyCancellable { item.cancel() }
+    }
+}
+
+/// Time that only moves when told to, so that a day of playback can be
+/// simulated in milliseconds, with the same result every time.
+///
+/// Actions run synchronously in `advance(to:)`, in deadline order, with
+/// `now` set to their deadline. Use it from one thread.
+public final class ManualSimulationClock: SimulationClock {
+    
+    private struct Timer {
+        let deadline: TimeInterval
+        let sequence: Int
+    }
+    
+    public private(set) var now: TimeInterval
+    
+    // Sorted by deadline, then by scheduling order.
+    private var timers: [Timer] = []
+    private var actions: [Int: () -> Void] = [:]
+    private var nextSequence = 0
+    
+    public init(now: TimeInterval = 0) {
+        self.now = now
+    }
+    
+    /// Number of actions waiting to run.
+    public var pendingCount: Int {
+        return actions.count
+    }
+    
+    public func schedule(after delay: TimeInterval, _ action: @escaping () -> Void) -> AnyCancellable {
+        let timer = Timer(deadline: now + max(0, delay), sequence: nextSequence)
+        nextSequence += 1
+        let index = timers.firstIndex { $0.deadline > timer.deadline } ?? timers.endIndex
+        timers.insert(timer, at: index)
+        actions[timer.sequence] = action
+        return AnyCancellable { [weak self] in
+            self?.cancel(timer.sequence)
+        }
+    }
+    
+    private func cancel(_ sequence: Int) {
+        guard actions.removeValue(forKey: sequence) != nil else {
+            return
+        }
+        timers.removeAll { $0.sequence == sequence }
+    }
+    
+    public func advance(by interval: TimeInterval) {
+        advance(to: now + interval)
+    }
+    
+    /// Runs every action due by `time`, including the ones scheduled by
+    /// those actions, then sets `now` to `time`.
+    public func advance(to time: TimeInterval) {
+        while runNext(notAfter: time) {}
+        now = max(now, time)
+    }
+    
+    /// Jumps to the next pending action and runs it. Returns `false` if
+    /// there is none.
+    @discardableResult
+    public func runNext() -> Bool {
+        return runNext(notAfter: .infinity)
+    }
+    
+    private func runNext(notAfter time: TimeInterval) -> Bool {
+        while let timer = timers.first, timer.deadline <= time {
+            timers.removeFirst()
+            guard let action = actions.removeValue(forKey: timer.sequence) else {
+                continue
+            }
+            now = max(now, timer.deadline)
+            action()
+            return true
+        }
+        return false
+    }
+}
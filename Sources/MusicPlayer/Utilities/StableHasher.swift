@@ -0,0 +1,29 @@
+//
+//  StableHasher.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+/// FNV-1a. Unlike `Hasher` it gives the same value in every process, for
+/// ids that are shared with other processes or saved.
+public struct StableHasher {
+    
+    public private(set) var value: UInt64 = 0xcbf29ce484222325
+    
+    public init() {}
+    
+    public mutating func combine(_ string: String) {
+        for byte in string.utf8 {
+            combine(byte)
+        }
+        // Separator, so that ("ab", "c") and ("a", "bc") differ.
+        combine(0x1F as UInt8)
+    }
+    
+    public mutating func combine(_ byte: UInt8) {
+        value = (value ^ UInt64(byte)) &* 0x100000001b3
+    }
+}
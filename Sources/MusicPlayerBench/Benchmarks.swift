@@ -0,0 +1,323 @@
+//
+//  Benchmarks.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+import MusicPlayer
+import AllocationCounter
+
+#if os(Linux)
+import gio
+#endif
+
+/// Measurements of the library itself, without any real player.
+enum Benchmarks {
+    
+    static func runAll() {
+        queueScaling()
+        print()
+        positionTickerAllocations()
+        print()
+        typedDispatch()
+        print()
+        playerCoding()
+        #if os(Linux)
+        print()
+        mprisMetadataDecoding()
+        #endif
+    }
+    
+    private static func seconds(_ body: () -> Void) -> TimeInterval {
+        let start = DispatchTime.now().uptimeNanoseconds
+        body()
+        return TimeInterval(DispatchTime.now().uptimeNanoseconds - start) / 1_000_000_000
+    }
+    
+    // MARK: - Queues
+    
+    /// Updates of N `Virtual` players, made on one shared serial queue, and
+    /// on a serial queue per player over a concurrent pool, the layout of
+    /// `DispatchQueue.player(_:)`. Every update publishes a new track and
+    /// state to a `NowPlaying` that follows all players, and to a `changes`
+    /// subscriber per player.
+    static func queueScaling() {
+        let cores = ProcessInfo.processInfo.activeProcessorCount
+        let updatesPerPlayer = 2000
+        print("player updates: \(updatesPerPlayer) per player, followed by NowPlaying, \(cores) cores")
+        print("players    shared serial    per-player queues    speedup")
+        for playerCount in Array(Set([1, 2, 4, 8, cores])).sorted() {
+            let shared = DispatchQueue(label: "bench.shared")
+            let sharedTime = playerUpdateTime(playerCount: playerCount, updatesPerPlayer: updatesPerPlayer) { _ in shared }
+            let pool = DispatchQueue(label: "bench.pool", attributes: .concurrent)
+            let queues = (0..<playerCount).map { DispatchQueue(label: "bench.player\($0)", target: pool) }
+            let pooledTime = playerUpdateTime(playerCount: playerCount, updatesPerPlayer: updatesPerPlayer) { queues[$0] }
+            let updates = Double(playerCount * updatesPerPlayer)
+            print(String(format: "%7d %11.0f /s %15.0f /s %13.2fx", playerCount, updates / sharedTime, updates / pooledTime, sharedTime / pooledTime))
+        }
+    }
+    
+    private static func playerUpdateTime(playerCount: Int, updatesPerPlayer: Int, queue: (Int) -> DispatchQueue) -> TimeInterval {
+        let tracks = (0..<16).map { index in
+            MusicTrack(id: "/org/mpris/MediaPlayer2/Track/\(index)", title: "Track number \(index)", album: "Some Album", artist: "Some Artist", duration: 180)
+        }
+        let players = (0..<playerCount).map { _ in MusicPlayers.Virtual(track: tracks[0], state: .paused(time: 0)) }
+        let nowPlaying = MusicPlayers.NowPlaying(players: players)
+        let subscribers = players.map { $0.changes.sink { _ in } }
+        
+        let time = seconds {
+            let group = DispatchGroup()
+            for update in 0..<updatesPerPlayer {
+                let track = tracks[update % tracks.count]
+                let state: PlaybackState = update % 4 == 3 ? .paused(time: Double(update)) : .playing(time: Double(update))
+                for (index, player) in players.enumerated() {
+                    queue(index).async(group: group) {
+                        player.currentTrack = track
+                        player.playbackState = state
+                    }
+                }
+            }
+            group.wait()
+        }
+        // Lets the selections still queued by this run finish before the
+        // next one is timed.
+        var evaluations = -1
+        while nowPlaying.selectionStatistics.evaluations != evaluations {
+            evaluations = nowPlaying.selectionStatistics.evaluations
+            Thread.sleep(forTimeInterval: 0.05)
+        }
+        withExtendedLifetime(subscribers) {}
+        return time
+    }
+    
+    // MARK: - Position Ticker
+    
+    /// Heap allocations per tick of a 1 kHz `PositionTicker`, and ticks
+    /// while the player is paused.
+    static func positionTickerAllocations() {
+        let player = MusicPlayers.Virtual(state: .playing(time: 0))
+        let ticker = PositionTicker(player: player, rate: 1000)
+        var position: TimeInterval = 0
+        let canceller = ticker.positions.sink { position = $0 }
+        // Let the timer and the subscription settle.
+        Thread.sleep(forTimeInterval: 0.2)
+        
+        let ticksBefore = ticker.tickCount
+        let allocationsBefore = lx_allocation_count()
+        Thread.sleep(forTimeInterval: 1)
+        let allocations = lx_allocation_count() - allocationsBefore
+        let ticks = ticker.tickCount - ticksBefore
+        
+        player.playbackState = .paused(time: position)
+        Thread.sleep(forTimeInterval: 0.05)
+        let pausedBefore = ticker.tickCount
+        Thread.sleep(forTimeInterval: 0.5)
+        let pausedTicks = ticker.tickCount - pausedBefore
+        
+        print("position ticker at 1 kHz:")
+        print("  ticks in 1 s:       \(ticks)")
+        if lx_allocation_counter_is_available() {
+            let perTick = ticks > 0 ? Double(allocations) / Double(ticks) : 0
+            print("  allocations:        \(allocations) in the whole process, \(String(format: "%.3f", perTick)) per tick")
+        } else {
+            print("  allocations:        not counted on this platform")
+        }
+        print("  ticks while paused: \(pausedTicks) in 0.5 s")
+        withExtendedLifetime(canceller) {}
+    }
+    
+    // MARK: - Dispatch
+    
+    /// Reads through `Agent`, which holds an existential, and through
+    /// `TypedAgent`, which the compiler specializes for the player type.
+    static func typedDispatch() {
+        let iterations = 10_000_000
+        let player = MusicPlayers.Virtual(state: .paused(time: 1))
+        let agent = MusicPlayers.Agent()
+        agent.designatedPlayer = player
+        let typedAgent = MusicPlayers.TypedAgent<MusicPlayers.Virtual>()
+        typedAgent.designatedPlayer = player
+        
+        var sum: TimeInterval = 0
+        let existentialTime = seconds {
+            for _ in 0..<iterations {
+                sum += agent.playbackState.time
+            }
+        }
+        let typedTime = seconds {
+            for _ in 0..<iterations {
+                sum += typedAgent.playbackState.time
+            }
+        }
+        print("playbackState reads, \(iterations) each:")
+        print(String(format: "  Agent (existential): %6.2f ns/read", existentialTime / Double(iterations) * 1e9))
+        print(String(format: "  TypedAgent<Virtual>: %6.2f ns/read, %.2fx", typedTime / Double(iterations) * 1e9, existentialTime / typedTime))
+        // Keeps the loops from being optimized away.
+        if sum < 0 {
+            print(sum)
+        }
+    }
+    
+    // MARK: - Coding
+    
+    private struct Sample: Codable {
+        var track: MusicTrack?
+        var state: PlaybackState
+    }
+    
+    /// The binary format against `JSONEncoder` and `JSONDecoder`, for the
+    /// track and state messages of the broker.
+    static func playerCoding() {
+        let samples = (0..<100).map { index in
+            Sample(track: MusicTrack(id: "/org/mpris/MediaPlayer2/Track/\(index)",
+                                     title: "Track number \(index) (Remastered)",
+                                     album: "Some Album",
+                                     artist: "Some Artist, Another Artist",
+                                     duration: 180 + Double(index),
+                                     fileURL: URL(fileURLWithPath: "/home/user/Music/Some Album/\(index).flac")),
+                   state: .playing(time: Double(index)))
+        }
+        let rounds = 500
+        let count = Double(rounds * samples.count)
+        
+        let jsonEncoder = JSONEncoder()
+        let jsonDecoder = JSONDecoder()
+        var jsonData: [Data] = []
+        let jsonEncodeTime = seconds {
+            for _ in 0..<rounds {
+                jsonData = samples.map { try! jsonEncoder.encode($0) }
+            }
+        }
+        let jsonBytes = jsonData.reduce(0) { $0 + $1.count }
+        var checksum = 0
+        let jsonDecodeTime = seconds {
+            for _ in 0..<rounds {
+                for data in jsonData {
+                    let sample = try! jsonDecoder.decode(Sample.self, from: data)
+                    checksum &+= sample.track?.title?.utf8.count ?? 0
+                }
+            }
+        }
+        
+        var binaryData: [[UInt8]] = []
+        let binaryEncodeTime = seconds {
+            for _ in 0..<rounds {
+                binaryData = samples.map { sample -> [UInt8] in
+                    var encoder = PlayerBinaryEncoder()
+                    encoder.encodeVersion()
+                    encoder.encode(sample.track)
+                    encoder.encode(sample.state)
+                    return encoder.bytes
+                }
+            }
+        }
+        let binaryBytes = binaryData.reduce(0) { $0 + $1.count }
+        // Only the title is read, like most consumers do, and everything in
+        // the second run.
+        let binaryDecodeTime = seconds {
+            for _ in 0..<rounds {
+                for bytes in binaryData {
+                    var decoder = PlayerBinaryDecoder(bytes)
+                    _ = decoder.decodeVersion()
+                    let track = decoder.decodeTrack()!
+                    _ = decoder.decodeState()
+                    checksum &+= track?.title?.utf8.count ?? 0
+                }
+            }
+        }
+        let binaryFullDecodeTime = seconds {
+            for _ in 0..<rounds {
+                for bytes in binaryData {
+                    var decoder = PlayerBinaryDecoder(bytes)
+                    _ = decoder.decodeVersion()
+                    let track = decoder.decodeTrack()!
+                    _ = decoder.decodeState()
+                    checksum &+= (track?.title?.utf8.count ?? 0) + (track?.album?.utf8.count ?? 0)
+                        + (track?.artist?.utf8.count ?? 0) + (track?.fileURL?.path.utf8.count ?? 0)
+                }
+            }
+        }
+        
+        func microseconds(_ time: TimeInterval) -> String {
+            return String(format: "%6.2f µs", time / count * 1e6)
+        }
+        print("track and state, \(Int(count)) each:")
+        print("           size      encode     decode     decode all")
+        print("  JSON     \(String(format: "%4d B", jsonBytes / samples.count))   \(microseconds(jsonEncodeTime))  \(microseconds(jsonDecodeTime))  \(microseconds(jsonDecodeTime))")
+        print("  binary   \(String(format: "%4d B", binaryBytes / samples.count))   \(microseconds(binaryEncodeTime))  \(microseconds(binaryDecodeTime))  \(microseconds(binaryFullDecodeTime))")
+        if checksum < 0 {
+            print(checksum)
+        }
+    }
+    
+    #if os(Linux)
+    
+    // MARK: - MPRIS Metadata
+    
+    /// A track built from each `Metadata` change: every field decoded up
+    /// front, and the lazy track, when only the id is read and when every
+    /// field is.
+    static func mprisMetadataDecoding() {
+        let text = """
+            {'mpris:trackid': <objectpath '/org/mpris/MediaPlayer2/Track/42'>,
+             'mpris:length': <int64 215000000>,
+             'mpris:artUrl': <'file:///home/user/.cache/covers/some-album.jpg'>,
+             'xesam:title': <'Track number 42 (Remastered)'>,
+             'xesam:album': <'Some Album'>,
+             'xesam:artist': <['Some Artist', 'Another Artist']>,
+             'xesam:albumArtist': <['Some Artist']>,
+             'xesam:url': <'file:///home/user/Music/Some%20Album/42.flac'>,
+             'xesam:trackNumber': <42>,
+             'xesam:discNumber': <1>}
+            """
+        let variant = g_variant_ref_sink(g_variant_parse(nil, text, nil, nil, nil))!
+        defer { g_variant_unref(variant) }
+        let events = 200_000
+        var checksum = 0
+        
+        let eagerTime = seconds {
+            for _ in 0..<events {
+                let metadata = MPRISMetadata(retaining: variant)
+                let track = MusicTrack(id: metadata.trackID!,
+                                       title: metadata.title,
+                                       album: metadata.album,
+                                       artist: metadata.artists?.joined(separator: ", "),
+                                       duration: metadata.length,
+                                       fileURL: metadata.url,
+                                       artwork: metadata.artURL)
+                checksum &+= track.id.utf8.count
+            }
+        }
+        let lazyTime = seconds {
+            for _ in 0..<events {
+                let track = MusicTrack(mprisMetadata: MPRISMetadata(retaining: variant))!
+                checksum &+= track.id.utf8.count
+            }
+        }
+        let lazyFullTime = seconds {
+            for _ in 0..<events {
+                let track = MusicTrack(mprisMetadata: MPRISMetadata(retaining: variant))!
+                checksum &+= track.id.utf8.count + (track.title?.utf8.count ?? 0) + (track.album?.utf8.count ?? 0)
+                    + (track.artist?.utf8.count ?? 0) + (track.fileURL?.path.utf8.count ?? 0)
+            }
+        }
+        
+        func microseconds(_ time: TimeInterval) -> String {
+            return String(format: "%6.2f µs", time / Double(events) * 1e6)
+        }
+        print("MPRIS metadata, \(events) events:")
+        print("  eager, all fields     \(microseconds(eagerTime))")
+        print("  lazy, id only         \(microseconds(lazyTime))")
+        print("  lazy, every field     \(microseconds(lazyFullTime))")
+        if checksum < 0 {
+            print(checksum)
+        }
+    }
+    
+    #endif
+}
@@ -0,0 +1,35 @@
+//
+//  main.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+
+let usage = """
+Usage: musicplayer-bench
+
+Runs the micro-benchmarks of the library, which need no player: player
+updates on shared and per-player queues, position ticker allocations, typed
+dispatch, binary coding and, on Linux, MPRIS metadata decoding.
+
+Allocations are counted by replacing malloc, calloc and realloc of this
+executable, which is why these benchmarks are not part of
+musicplayer-monitor.
+"""
+
+for argument in CommandLine.arguments.dropFirst() {
+    switch argument {
+    case "-h", "--help":
+        print(usage)
+        exit(0)
+    default:
+        FileHandle.standardError.write("unknown argument: \(argument)\n\(usage)\n".data(using: .utf8)!)
+        exit(2)
+    }
+}
+
+Benchmarks.runAll()
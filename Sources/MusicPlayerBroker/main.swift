@@ -0,0 +1,171 @@
+//
+//  main.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+import MusicPlayer
+#if os(Linux)
+import MPRISServer
+#endif
+
+let usage = """
+Usage: musicplayer-broker [--socket PATH] [--mpris NAME]
+       musicplayer-broker --bench [--clients N] [--events N]
+
+Serves the system's now playing state over a Unix domain socket. Connect with
+MusicPlayers.Broker.
+
+  --socket PATH   Socket path (default: \(MusicPlayers.Broker.defaultPath))
+  --mpris NAME    Also export now playing as org.mpris.MediaPlayer2.NAME (Linux)
+  --bench         Measure fan-out of a simulated player to local clients
+  --clients N     Number of clients in bench mode (default: 100)
+  --events N      Number of state changes in bench mode (default: 1000)
+"""
+
+var socketPath = MusicPlayers.Broker.defaultPath
+var mprisName: String?
+var benchMode = false
+var clientCount = 100
+var eventCount = 1000
+
+var arguments = CommandLine.arguments.dropFirst().makeIterator()
+while let argument = arguments.next() {
+    switch argument {
+    case "--socket":
+        socketPath = arguments.next() ?? socketPath
+    case "--mpris":
+        mprisName = arguments.next()
+    case "--bench":
+        benchMode = true
+    case "--clients":
+        clientCount = arguments.next().flatMap(Int.init) ?? clientCount
+    case "--events":
+        eventCount = arguments.next().flatMap(Int.init) ?? eventCount
+    case "-h", "--help":
+        print(usage)
+        exit(0)
+    default:
+        FileHandle.standardError.write("unknown argument: \(argument)\n\(usage)\n".data(using: .utf8)!)
+        exit(2)
+    }
+}
+
+signal(SIGPIPE, SIG_IGN)
+
+// MARK: - Bench
+
+func runFanOutBenchmark() -> Never {
+    let path = NSTemporaryDirectory() + "musicplayer-broker-bench-\(getpid()).sock"
+    let source = MusicPlayers.Virtual(state: .paused(time: -1))
+    guard let broker = NowPlayingBroker(player: source, path: path) else {
+        print("failed to listen on \(path)")
+        exit(1)
+    }
+    
+    let lock = NSLock()
+    var expected: TimeInterval = .nan
+    var received = 0
+    let allReceived = DispatchSemaphore(value: 0)
+    
+    var clients: [MusicPlayers.Broker] = []
+    var cancellers: [AnyCancellable] = []
+    for _ in 0..<clientCount {
+        guard let client = MusicPlayers.Broker(path: path) else {
+            print("failed to connect client \(clients.count)")
+            exit(1)
+        }
+        cancellers.append(client.playbackStateWillChange.sink { state in
+            lock.lock()
+            defer { lock.unlock() }
+            guard state.time == expected else { return }
+            received += 1
+            if received == clientCount {
+                allReceived.signal()
+            }
+        })
+        clients.append(client)
+    }
+    while broker.clientCount < clientCount {
+        usleep(1000)
+    }
+    
+    var latencies: [TimeInterval] = []
+    latencies.reserveCapacity(eventCount)
+    let begin = Date()
+    for i in 0..<eventCount {
+        lock.lock()
+        expected = TimeInterval(i)
+        received = 0
+        lock.unlock()
+        let start = Date()
+        source.playbackState = .paused(time: TimeInterval(i))
+        guard allReceived.wait(timeout: .now() + 5) == .success else {
+            print("timed out waiting for event \(i)")
+            exit(1)
+        }
+        latencies.append(Date().timeIntervalSince(start))
+    }
+    let elapsed = Date().timeIntervalSince(begin)
+    
+    latencies.sort()
+    func percentile(_ p: Double) -> String {
+        let value = latencies[min(latencies.count - 1, Int(Double(latencies.count) * p))]
+        return String(format: "%.3f ms", value * 1000)
+    }
+    print("clients:     \(clientCount)")
+    print("events:      \(eventCount)")
+    print("throughput:  \(String(format: "%.0f", Double(eventCount) / elapsed)) events/s, \(String(format: "%.0f", Double(eventCount * clientCount) / elapsed)) deliveries/s")
+    print("fan-out p50: \(percentile(0.5))")
+    print("fan-out p99: \(percentile(0.99))")
+    print("fan-out max: \(percentile(1))")
+    withExtendedLifetime((broker, clients, cancellers)) {}
+    exit(0)
+}
+
+if benchMode {
+    runFanOutBenchmark()
+}
+
+// MARK: - Serve
+
+#if os(Linux)
+
+guard let nowPlaying = MusicPlayers.MPRISNowPlaying() else {
+    print("failed to connect to the session bus")
+    exit(1)
+}
+var mprisServer: NowPlayingMPRISServer?
+if let name = mprisName {
+    mprisServer = NowPlayingMPRISServer(player: nowPlaying, name: name)
+    if mprisServer == nil {
+        print("failed to export org.mpris.MediaPlayer2.\(name)")
+        exit(1)
+    }
+}
+Thread.detachNewThread {
+    GRunLoop.main.run()
+}
+
+#elseif os(macOS)
+
+var players: [MusicPlayerProtocol] = MusicPlayerName.scriptableCases.compactMap { MusicPlayers.Scriptable(name: $0) }
+if let systemMedia = MusicPlayers.SystemMedia() {
+    players.append(systemMedia)
+}
+let nowPlaying = MusicPlayers.NowPlaying(players: players)
+
+#endif
+
+guard let broker = NowPlayingBroker(player: nowPlaying, path: socketPath) else {
+    print("failed to listen on \(socketPath)")
+    exit(1)
+}
+print("serving now playing on \(socketPath)")
+
+dispatchMain()
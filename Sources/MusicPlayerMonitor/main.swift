@@ -0,0 +1,395 @@
+//
+//  main.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import Foundation
+import CXShim
+import MusicPlayer
+
+#if os(Linux)
+import gio
+#endif
+
+let usage = """
+Usage: musicplayer-monitor [options]
+
+Follows the MPRIS players on the session and system buses, or on the given
+buses, and prints their changes as JSON lines, one object per event.
+
+  --stats               Print per-player event rates, read latencies and
+                        bus calls every interval instead of events
+  --interval S          Seconds between --stats reports (default: 5)
+  --bench               Measure the live players for --duration seconds,
+                        print a summary and exit
+  --duration S          Seconds to run --bench (default: 30)
+  --idle-threshold S    Seconds without playback before idle mode (default: 300)
+  --bus BUS             Follow the players on BUS, which is session, system
+                        or a D-Bus address; repeat for more buses
+  --interest FIELDS     Follow only FIELDS, like track,state, out of track,
+                        title, artist, album, duration, artwork, fileURL,
+                        metadata, state and position
+"""
+
+enum Mode {
+    case stream
+    case stats
+    case bench
+}
+
+var mode = Mode.stream
+var interval: TimeInterval = 5
+var duration: TimeInterval = 30
+var idlePolicy = IdlePolicy.default
+var busArguments: [String] = []
+var interestArgument: String?
+
+var arguments = CommandLine.arguments.dropFirst().makeIterator()
+func nextNumber(for argument: String) -> Double {
+    guard let value = arguments.next().flatMap(Double.init), value > 0 else {
+        FileHandle.standardError.write("\(argument) needs a positive number\n\(usage)\n".data(using: .utf8)!)
+        exit(2)
+    }
+    return value
+}
+while let argument = arguments.next() {
+    switch argument {
+    case "--stats":             mode = .stats
+    case "--bench":             mode = .bench
+    case "--interval":          interval = nextNumber(for: argument)
+    case "--duration":          duration = nextNumber(for: argument)
+    case "--idle-threshold":    idlePolicy.threshold = nextNumber(for: argument)
+    case "--bus":
+        guard let bus = arguments.next() else {
+            FileHandle.standardError.write("\(argument) needs a bus\n\(usage)\n".data(using: .utf8)!)
+            exit(2)
+        }
+        busArguments.append(bus)
+    case "--interest":
+        guard let fields = arguments.next() else {
+            FileHandle.standardError.write("\(argument) needs a list of fields\n\(usage)\n".data(using: .utf8)!)
+            exit(2)
+        }
+        interestArgument = fields
+    case "-h", "--help":
+        print(usage)
+        exit(0)
+    default:
+        FileHandle.standardError.write("unknown argument: \(argument)\n\(usage)\n".data(using: .utf8)!)
+        exit(2)
+    }
+}
+
+func fail(_ message: String) -> Never {
+    FileHandle.standardError.write("\(message)\n".data(using: .utf8)!)
+    exit(1)
+}
+
+#if os(Linux)
+
+func now() -> TimeInterval {
+    return TimeInterval(DispatchTime.now().uptimeNanoseconds) / 1_000_000_000
+}
+
+func milliseconds(_ time: TimeInterval?) -> String {
+    return time.map { String(format: "%.2f", $0 * 1000) } ?? "-"
+}
+
+func padded(_ string: String, to width: Int) -> String {
+    let string = String(string.prefix(width))
+    return string + String(repeating: " ", count: width - string.count)
+}
+
+func rightAligned(_ string: String, to width: Int) -> String {
+    return String(repeating: " ", count: max(0, width - string.count)) + string
+}
+
+/// User and system time of the process.
+func processorTime() -> TimeInterval {
+    var usage = rusage()
+    getrusage(RUSAGE_SELF, &usage)
+    return TimeInterval(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+        + TimeInterval(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1_000_000
+}
+
+extension PlayerChanges {
+    
+    private static let labels: [(PlayerChanges, String)] = [
+        (.track, "track"),
+        (.title, "title"),
+        (.artist, "artist"),
+        (.album, "album"),
+        (.duration, "duration"),
+        (.artwork, "artwork"),
+        (.fileURL, "fileURL"),
+        (.stateKind, "state"),
+        (.positionJump, "position"),
+    ]
+    
+    var names: [String] {
+        return PlayerChanges.labels.filter { contains($0.0) }.map { $0.1 }
+    }
+    
+    /// The fields named in a comma-separated list, or nil if one is unknown.
+    init?(names list: String) {
+        self = []
+        for name in list.split(separator: ",") {
+            if name == "metadata" {
+                formUnion(.metadata)
+            } else if let label = PlayerChanges.labels.first(where: { $0.1 == name }) {
+                insert(label.0)
+            } else {
+                return nil
+            }
+        }
+    }
+}
+
+extension PlaybackState {
+    
+    var kind: String {
+        switch self {
+        case .stopped:          return "stopped"
+        case .playing:          return "playing"
+        case .paused:           return "paused"
+        case .fastForwarding:   return "fastForwarding"
+        case .rewinding:        return "rewinding"
+        }
+    }
+}
+
+/// Events and bus traffic of one endpoint.
+final class PlayerRecord {
+    
+    let player: MusicPlayers.MPRIS
+    var events = 0
+    var canceller: AnyCancellable?
+    /// Counts at the last report.
+    var reported: (events: Int, wakeups: WakeupCounters) = (0, WakeupCounters())
+    
+    init(player: MusicPlayers.MPRIS) {
+        self.player = player
+    }
+}
+
+final class Monitor {
+    
+    let nowPlaying: MusicPlayers.MPRISNowPlaying
+    /// Subscribed to on every endpoint, or all changes if nil.
+    let interest: PlayerChanges?
+    let start = now()
+    let startProcessorTime = processorTime()
+    var records: [ObjectIdentifier: PlayerRecord] = [:]
+    var designatedCanceller: AnyCancellable?
+    var lastReport = now()
+    
+    // Events come from the main loop and from player queues.
+    let lock = NSLock()
+    
+    init(nowPlaying: MusicPlayers.MPRISNowPlaying, interest: PlayerChanges?) {
+        self.nowPlaying = nowPlaying
+        self.interest = interest
+        designatedCanceller = nowPlaying.$designatedPlayer.sink { [unowned self] player in
+            self.emit(["event": "designated", "player": player.map { $0.playerIdentifier as Any } ?? NSNull()])
+        }
+    }
+    
+    func emit(_ object: [String: Any]) {
+        guard mode == .stream else {
+            return
+        }
+        var object = object
+        object["time"] = ((now() - start) * 1000).rounded() / 1000
+        guard let data = try? JSONSerialization.data(withJSONObject: object) else {
+            return
+        }
+        lock.lock()
+        FileHandle.standardOutput.write(data)
+        FileHandle.standardOutput.write("\n".data(using: .utf8)!)
+        lock.unlock()
+    }
+    
+    private func changeDidHappen(_ event: PlayerChangeEvent, in record: PlayerRecord) {
+        lock.lock()
+        record.events += 1
+        lock.unlock()
+        guard mode == .stream else {
+            return
+        }
+        var object: [String: Any] = [
+            "event": "change",
+            "player": record.player.playerIdentifier,
+            "changes": event.changes.names,
+            "state": event.playbackState.kind,
+            "position": (event.playbackState.time * 1000).rounded() / 1000,
+        ]
+        if let track = event.track {
+            var fields: [String: Any] = ["id": track.id]
+            fields["title"] = track.title
+            fields["artist"] = track.artist
+            fields["album"] = track.album
+            fields["duration"] = track.duration
+            fields["fileURL"] = track.fileURL?.absoluteString
+            object["track"] = fields
+        } else {
+            object["track"] = NSNull()
+        }
+        emit(object)
+    }
+    
+    /// Runs on the GLib main loop, like the players themselves.
+    func sample() {
+        var present = Set<ObjectIdentifier>()
+        for player in nowPlaying.endpoints {
+            let id = ObjectIdentifier(player)
+            present.insert(id)
+            guard records[id] == nil else {
+                continue
+            }
+            let record = PlayerRecord(player: player)
+            let changes = interest.map { player.changes(of: $0) } ?? player.changes
+            record.canceller = changes.traceDelivery().sink { [unowned self, unowned record] event in
+                self.changeDidHappen(event, in: record)
+            }
+            records[id] = record
+            emit(["event": "appeared", "player": player.playerIdentifier, "state": player.playbackState.kind])
+        }
+        for (id, record) in records where !present.contains(id) {
+            record.canceller?.cancel()
+            records[id] = nil
+            emit(["event": "vanished", "player": record.player.playerIdentifier])
+        }
+        
+        let time = now()
+        if mode == .stats && time - lastReport >= interval {
+            report(at: time)
+        }
+        if mode == .bench && time - start >= duration {
+            finish(at: time)
+        }
+    }
+    
+    private var sortedRecords: [PlayerRecord] {
+        return records.values.sorted { $0.player.playerIdentifier < $1.player.playerIdentifier }
+    }
+    
+    private func report(at time: TimeInterval) {
+        let elapsed = time - lastReport
+        lastReport = time
+        print(String(format: "[%6.0fs] %d players", time - start, records.count) + (nowPlaying.isIdle ? ", idle" : ""))
+        print(padded("player", to: 30) + "  events/s  reads  calls  timeouts  avg ms  max ms")
+        for record in sortedRecords {
+            lock.lock()
+            let events = record.events
+            lock.unlock()
+            let wakeups = record.player.wakeups
+            let previous = record.reported.wakeups
+            let refreshes = wakeups.refreshes - previous.refreshes
+            let readTime = wakeups.readTime - previous.readTime
+            var flags: [String] = []
+            if record.player.isPolling {
+                flags.append("polling")
+            }
+            if record.player.isDegraded {
+                flags.append("degraded")
+            }
+            if nowPlaying.designatedPlayer === record.player {
+                flags.append("designated")
+            }
+            // The maximum is since launch, as counters don't reset.
+            print(padded(record.player.playerIdentifier, to: 30)
+                + String(format: " %9.2f %6d %6d %9d ", Double(events - record.reported.events) / elapsed, refreshes, wakeups.calls - previous.calls, wakeups.timeouts - previous.timeouts)
+                + rightAligned(milliseconds(refreshes > 0 ? readTime / Double(refreshes) : nil), to: 7) + " "
+                + rightAligned(milliseconds(wakeups.refreshes > 0 ? wakeups.maximumReadTime : nil), to: 7) + "  "
+                + flags.joined(separator: ", "))
+            record.reported = (events, wakeups)
+        }
+        print()
+        fflush(stdout)
+    }
+    
+    private func finish(at time: TimeInterval) -> Never {
+        let elapsed = time - start
+        let cpu = processorTime() - startProcessorTime
+        let wakeups = nowPlaying.wakeups
+        lock.lock()
+        let events = records.values.reduce(0) { $0 + $1.events }
+        lock.unlock()
+        print("""
+            duration:       \(String(format: "%.1f s", elapsed)), \(String(format: "%.3f s", cpu)) processor time (\(String(format: "%.2f%%", cpu / elapsed * 100)))
+            players:        \(records.count)\(nowPlaying.isIdle ? ", idle at the end" : "")
+            events:         \(events), \(String(format: "%.2f", Double(events) / elapsed))/s
+            wakeups:        \(wakeups.signals) signals (\(wakeups.shedSignals) shed while idle), \(wakeups.polls) polls
+            bus calls:      \(wakeups.calls), \(String(format: "%.2f", Double(wakeups.calls) / elapsed))/s, \(wakeups.timeouts) timed out
+            reads:          \(wakeups.refreshes), average \(milliseconds(wakeups.averageReadTime)) ms, max \(milliseconds(wakeups.refreshes > 0 ? wakeups.maximumReadTime : nil)) ms
+            """)
+        print()
+        print(padded("player", to: 30) + "  events  reads  calls  timeouts  avg ms  max ms")
+        for record in sortedRecords {
+            lock.lock()
+            let events = record.events
+            lock.unlock()
+            let wakeups = record.player.wakeups
+            print(padded(record.player.playerIdentifier, to: 30)
+                + String(format: " %7d %6d %6d %9d ", events, wakeups.refreshes, wakeups.calls, wakeups.timeouts)
+                + rightAligned(milliseconds(wakeups.averageReadTime), to: 7) + " "
+                + rightAligned(milliseconds(wakeups.refreshes > 0 ? wakeups.maximumReadTime : nil), to: 7))
+        }
+        print()
+        print(EventTracer.shared.summaryDescription)
+        fflush(stdout)
+        exit(0)
+    }
+}
+
+signal(SIGPIPE, SIG_IGN)
+
+// Before the players are created, so discovery is traced too.
+EventTracer.isEnabled = mode == .bench
+let buses = busArguments.map { argument -> MPRISBus in
+    switch argument {
+    case "session": return .session
+    case "system":  return .system
+    default:        return .address(argument)
+    }
+}
+let interest = interestArgument.map { argument -> PlayerChanges in
+    guard let fields = PlayerChanges(names: argument) else {
+        fail("--interest has an unknown field: \(argument)\n\(usage)")
+    }
+    return fields
+}
+let connected = buses.isEmpty ? MusicPlayers.MPRISNowPlaying() : MusicPlayers.MPRISNowPlaying(buses: buses)
+guard let nowPlaying = connected else {
+    fail("failed to connect to the bus")
+}
+for bus in buses where !nowPlaying.buses.contains(bus) {
+    FileHandle.standardError.write("failed to connect to \(bus)\n".data(using: .utf8)!)
+}
+nowPlaying.idlePolicy = idlePolicy
+if interest != nil {
+    // Only what the subscriptions of the monitor ask for.
+    nowPlaying.endpointInterest = []
+}
+let monitor = Monitor(nowPlaying: nowPlaying, interest: interest)
+
+let onSample: @convention(c) (gpointer?) -> gboolean = { data in
+    Unmanaged<Monitor>.fromOpaque(data!).takeUnretainedValue().sample()
+    return 1 // G_SOURCE_CONTINUE
+}
+g_timeout_add(100, onSample, Unmanaged.passUnretained(monitor).toOpaque())
+Thread.detachNewThread {
+    GRunLoop.main.run()
+}
+
+dispatchMain()
+
+#else
+
+fail("musicplayer-monitor needs MPRIS, which is only available on Linux; musicplayer-bench runs anywhere")
+
+#endif
@@ -0,0 +1,149 @@
+//
+//  NowPlayingSegment.c
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#include "NowPlayingSegment.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LXNP_SEGMENT_MAGIC 0x504e584cu /* "LXNP" */
+
+/* A write is one memcpy of the snapshot, so a write that is still in
+ * progress after this many attempts never finishes: its writer died. */
+#define LXNP_READ_ATTEMPTS 100000
+
+struct LXNPSegment {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    /* Odd while a write is in progress. */
+    _Atomic uint32_t sequence;
+    LXNPSnapshot snapshot;
+};
+
+static LXNPSegment *LXNPSegmentMap(const char *name, int flags, int prot) {
+    int fd = shm_open(name, flags, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    if ((flags & O_CREAT) && ftruncate(fd, sizeof(LXNPSegment)) != 0) {
+        close(fd);
+        return NULL;
+    }
+    void *address = mmap(NULL, sizeof(LXNPSegment), prot, MAP_SHARED, fd, 0);
+    close(fd);
+    return address == MAP_FAILED ? NULL : address;
+}
+
+LXNPSegment *LXNPSegmentCreate(const char *name) {
+    LXNPSegment *segment = LXNPSegmentMap(name, O_RDWR | O_CREAT, PROT_READ | PROT_WRITE);
+    if (segment == NULL) {
+        return NULL;
+    }
+    if (segment->magic != LXNP_SEGMENT_MAGIC || segment->version != LXNP_SEGMENT_VERSION || segment->size != sizeof(LXNPSegment)) {
+        /* New, or left by another layout. Readers check the magic last. */
+        segment->magic = 0;
+        atomic_thread_fence(memory_order_release);
+        atomic_store_explicit(&segment->sequence, 0, memory_order_relaxed);
+        segment->size = sizeof(LXNPSegment);
+        segment->version = LXNP_SEGMENT_VERSION;
+        atomic_thread_fence(memory_order_release);
+        segment->magic = LXNP_SEGMENT_MAGIC;
+    } else if (atomic_load_explicit(&segment->sequence, memory_order_relaxed) & 1) {
+        /* The previous writer died in the middle of a write. Starting over
+         * from zero keeps readers from taking its torn snapshot, and from
+         * taking the next one while it's being written. */
+        atomic_store_explicit(&segment->sequence, 0, memory_order_release);
+    }
+    return segment;
+}
+
+LXNPSegment *LXNPSegmentOpen(const char *name) {
+    LXNPSegment *segment = LXNPSegmentMap(name, O_RDONLY, PROT_READ);
+    if (segment == NULL) {
+        return NULL;
+    }
+    if (segment->magic != LXNP_SEGMENT_MAGIC || segment->version != LXNP_SEGMENT_VERSION || segment->size != sizeof(LXNPSegment)) {
+        munmap(segment, sizeof(LXNPSegment));
+        return NULL;
+    }
+    return segment;
+}
+
+void LXNPSegmentClose(LXNPSegment *segment) {
+    munmap(segment, sizeof(LXNPSegment));
+}
+
+void LXNPSegmentUnlink(const char *name) {
+    shm_unlink(name);
+}
+
+void LXNPSegmentWrite(LXNPSegment *segment, const LXNPSnapshot *snapshot) {
+    uint32_t sequence = atomic_load_explicit(&segment->sequence, memory_order_relaxed);
+    atomic_store_explicit(&segment->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&segment->snapshot, snapshot, sizeof(LXNPSnapshot));
+    atomic_store_explicit(&segment->sequence, sequence + 2, memory_order_release);
+}
+
+bool LXNPSegmentRead(const LXNPSegment *segment, LXNPSnapshot *snapshot) {
+    _Atomic uint32_t *sequencePointer = (_Atomic uint32_t *)&segment->sequence;
+    for (int attempt = 0; attempt < LXNP_READ_ATTEMPTS; attempt++) {
+        uint32_t before = atomic_load_explicit(sequencePointer, memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        if (before & 1) {
+            continue;
+        }
+        memcpy(snapshot, &segment->snapshot, sizeof(LXNPSnapshot));
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t after = atomic_load_explicit(sequencePointer, memory_order_relaxed);
+        if (before == after) {
+            return true;
+        }
+    }
+    return false;
+}
+
+double LXNPSnapshotPosition(const LXNPSnapshot *snapshot, double now) {
+    double position = snapshot->position + (now - snapshot->timestamp) * snapshot->rate;
+    if (snapshot->duration > 0 && position > snapshot->duration) {
+        return snapshot->duration;
+    }
+    return position;
+}
+
+double LXNPCurrentTime(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+void LXNPCopyString(char *field, const char *string) {
+    if (string == NULL) {
+        field[0] = '\0';
+        return;
+    }
+    size_t length = strlen(string);
+    if (length >= LXNP_STRING_CAPACITY) {
+        length = LXNP_STRING_CAPACITY - 1;
+        /* Don't cut a multi-byte sequence in half. */
+        while (length > 0 && ((unsigned char)string[length] & 0xC0) == 0x80) {
+            length--;
+        }
+    }
+    memcpy(field, string, length);
+    field[length] = '\0';
+}
@@ -0,0 +1,112 @@
+//
+//  NowPlayingSegment.h
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#ifndef NowPlayingSegment_h
+#define NowPlayingSegment_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef __has_feature
+#define __has_feature(x) 0
+#endif
+
+#if __has_feature(nullability)
+#define LXNP_NULLABLE _Nullable
+#define LXNP_NONNULL _Nonnull
+#else
+#define LXNP_NULLABLE
+#define LXNP_NONNULL
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A fixed-layout shared memory region holding the now playing track and
+ * playback state, guarded by a sequence lock.
+ *
+ * There is one writer per segment. Readers map the segment read-only and
+ * take snapshots without system calls, locks or allocation; a snapshot that
+ * raced with a write is simply retried. The position is not updated while
+ * playing: readers extrapolate it from `position`, `timestamp` and `rate`.
+ */
+
+#define LXNP_SEGMENT_VERSION 1
+#define LXNP_STRING_CAPACITY 256
+
+typedef enum {
+    LXNPPlaybackStateStopped = 0,
+    LXNPPlaybackStatePlaying = 1,
+    LXNPPlaybackStatePaused = 2,
+    LXNPPlaybackStateFastForwarding = 3,
+    LXNPPlaybackStateRewinding = 4,
+} LXNPPlaybackState;
+
+typedef struct {
+    /* Incremented whenever the track changes. */
+    uint64_t trackGeneration;
+    /* Zero if there is no track. */
+    uint64_t trackHash;
+    int32_t playbackState; /* LXNPPlaybackState */
+    int32_t hasTrack;
+    /* Playback position in seconds, valid at `timestamp`. */
+    double position;
+    /* Seconds since 1970, CLOCK_REALTIME. */
+    double timestamp;
+    /* 1 while playing, 0 otherwise. */
+    double rate;
+    /* Negative if unknown. */
+    double duration;
+    /* NUL-terminated UTF-8, truncated to fit. */
+    char trackID[LXNP_STRING_CAPACITY];
+    char title[LXNP_STRING_CAPACITY];
+    char artist[LXNP_STRING_CAPACITY];
+    char album[LXNP_STRING_CAPACITY];
+} LXNPSnapshot;
+
+typedef struct LXNPSegment LXNPSegment;
+
+/* Creates (or takes over) the named segment for writing. `name` follows
+ * shm_open(3), e.g. "/musicplayer-nowplaying". A segment left in the middle
+ * of a write reads as never written until the next write. */
+LXNPSegment *LXNP_NULLABLE LXNPSegmentCreate(const char *LXNP_NONNULL name);
+
+/* Maps an existing segment read-only. Returns NULL if it doesn't exist or
+ * has an incompatible layout. */
+LXNPSegment *LXNP_NULLABLE LXNPSegmentOpen(const char *LXNP_NONNULL name);
+
+void LXNPSegmentClose(LXNPSegment *LXNP_NONNULL segment);
+
+void LXNPSegmentUnlink(const char *LXNP_NONNULL name);
+
+void LXNPSegmentWrite(LXNPSegment *LXNP_NONNULL segment, const LXNPSnapshot *LXNP_NONNULL snapshot);
+
+/* Copies a consistent snapshot. Returns false if the segment was never
+ * written, or if a write doesn't finish within a bounded number of
+ * attempts, as when its writer died in the middle of it. */
+bool LXNPSegmentRead(const LXNPSegment *LXNP_NONNULL segment, LXNPSnapshot *LXNP_NONNULL snapshot);
+
+/* Extrapolated position at `now` (seconds since 1970). */
+double LXNPSnapshotPosition(const LXNPSnapshot *LXNP_NONNULL snapshot, double now);
+
+/* CLOCK_REALTIME in seconds. Served from the vDSO on Linux and the commpage
+ * on macOS, so no system call is made. */
+double LXNPCurrentTime(void);
+
+/* Copies `string` into a snapshot string field, truncating on a UTF-8
+ * character boundary. */
+void LXNPCopyString(char *LXNP_NONNULL field, const char *LXNP_NULLABLE string);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NowPlayingSegment_h */
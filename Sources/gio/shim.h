@@ -0,0 +1 @@
+#include <gio/gio.h>
@@ -0,0 +1,2 @@
+#include <playerctl/playerctl.h>
+#include <gio/gio.h>
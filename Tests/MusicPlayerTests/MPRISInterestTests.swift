@@ -0,0 +1,71 @@
+//
+//  MPRISInterestTests.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if os(Linux)
+
+import XCTest
+import CXShim
+import MusicPlayer
+import MPRISMock
+import gio
+
+final class MPRISInterestTests: XCTestCase {
+    
+    /// Runs the default main context, where the mock and the endpoints
+    /// dispatch, until `condition` holds.
+    private func iterate(timeout: TimeInterval = 5, until condition: () -> Bool) -> Bool {
+        let deadline = Date(timeIntervalSinceNow: timeout)
+        while !condition() {
+            guard Date() < deadline else {
+                return false
+            }
+            if g_main_context_iteration(nil, 0) == 0 {
+                usleep(1000)
+            }
+        }
+        return true
+    }
+    
+    func testInterestNarrowsAfterCancel() throws {
+        guard let bus = PrivateBus() else {
+            throw XCTSkip("dbus-daemon is not available")
+        }
+        defer { bus.stop() }
+        let mock = try XCTUnwrap(MockMPRISPlayer(address: bus.address, busName: "org.mpris.MediaPlayer2.test", identity: "test"))
+        mock.appear()
+        defer { mock.vanish() }
+        
+        let nowPlaying = try XCTUnwrap(MusicPlayers.MPRISNowPlaying(buses: [.address(bus.address)]))
+        nowPlaying.endpointInterest = []
+        XCTAssertTrue(iterate { !nowPlaying.endpoints.isEmpty }, "mock player not found")
+        let endpoint = try XCTUnwrap(nowPlaying.endpoints.first)
+        XCTAssertTrue(iterate { endpoint.interest == [.stateKind] }, "interest is \(endpoint.interest)")
+        
+        let lock = NSLock()
+        var events: [PlayerChangeEvent] = []
+        let subscription = endpoint.changes(of: [.track]).sink { event in
+            lock.lock()
+            events.append(event)
+            lock.unlock()
+        }
+        XCTAssertTrue(iterate { endpoint.interest.contains(.track) }, "interest is \(endpoint.interest)")
+        
+        mock.nextTrack()
+        XCTAssertTrue(iterate {
+            lock.lock()
+            defer { lock.unlock() }
+            return events.contains { $0.changes.contains(.track) }
+        }, "track change not delivered")
+        
+        subscription.cancel()
+        XCTAssertTrue(iterate { endpoint.interest == [.stateKind] }, "interest is \(endpoint.interest)")
+    }
+}
+
+#endif
@@ -0,0 +1,114 @@
+//
+//  NowPlayingSegmentTests.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+#if canImport(NowPlayingSegment)
+
+import XCTest
+import NowPlayingSegment
+
+final class NowPlayingSegmentTests: XCTestCase {
+    
+    /// Offset of the sequence counter, after magic, version and size.
+    private static let sequenceOffset = 12
+    
+    private let name = "/musicplayer-tests-\(ProcessInfo.processInfo.processIdentifier)"
+    
+    override func setUp() {
+        super.setUp()
+        LXNPSegmentUnlink(name)
+    }
+    
+    override func tearDown() {
+        LXNPSegmentUnlink(name)
+        super.tearDown()
+    }
+    
+    private func snapshot(_ value: Double) -> LXNPSnapshot {
+        var snapshot = LXNPSnapshot()
+        snapshot.hasTrack = 1
+        snapshot.trackGeneration = UInt64(value)
+        snapshot.position = value
+        snapshot.timestamp = value
+        snapshot.duration = value
+        return snapshot
+    }
+    
+    func testReadAfterWrite() throws {
+        let writer = try XCTUnwrap(LXNPSegmentCreate(name))
+        defer { LXNPSegmentClose(writer) }
+        let reader = try XCTUnwrap(LXNPSegmentOpen(name))
+        defer { LXNPSegmentClose(reader) }
+        
+        var read = LXNPSnapshot()
+        XCTAssertFalse(LXNPSegmentRead(reader, &read), "never written")
+        var written = snapshot(7)
+        LXNPSegmentWrite(writer, &written)
+        XCTAssertTrue(LXNPSegmentRead(reader, &read))
+        XCTAssertEqual(read.position, 7)
+        XCTAssertEqual(read.trackGeneration, 7)
+    }
+    
+    func testTornWrite() throws {
+        let writer = try XCTUnwrap(LXNPSegmentCreate(name))
+        let reader = try XCTUnwrap(LXNPSegmentOpen(name))
+        defer { LXNPSegmentClose(reader) }
+        var written = snapshot(1)
+        LXNPSegmentWrite(writer, &written)
+        
+        // The writer dies in the middle of the next write.
+        let sequence = UnsafeMutableRawPointer(writer).advanced(by: NowPlayingSegmentTests.sequenceOffset)
+        let stable = sequence.load(as: UInt32.self)
+        XCTAssertEqual(stable & 1, 0)
+        sequence.storeBytes(of: stable + 1, as: UInt32.self)
+        LXNPSegmentClose(writer)
+        
+        var read = LXNPSnapshot()
+        XCTAssertFalse(LXNPSegmentRead(reader, &read), "torn snapshot read")
+        
+        // A new writer takes over, and the torn snapshot is never read.
+        let newWriter = try XCTUnwrap(LXNPSegmentCreate(name))
+        defer { LXNPSegmentClose(newWriter) }
+        XCTAssertFalse(LXNPSegmentRead(reader, &read), "torn snapshot read after takeover")
+        written = snapshot(2)
+        LXNPSegmentWrite(newWriter, &written)
+        XCTAssertTrue(LXNPSegmentRead(reader, &read))
+        XCTAssertEqual(read.position, 2)
+    }
+    
+    func testConcurrentWrites() throws {
+        let writer = try XCTUnwrap(LXNPSegmentCreate(name))
+        defer { LXNPSegmentClose(writer) }
+        let reader = try XCTUnwrap(LXNPSegmentOpen(name))
+        defer { LXNPSegmentClose(reader) }
+        
+        let writes = 100_000
+        let done = DispatchSemaphore(value: 0)
+        DispatchQueue.global().async {
+            for value in 1...writes {
+                var written = self.snapshot(Double(value))
+                LXNPSegmentWrite(writer, &written)
+            }
+            done.signal()
+        }
+        var read = LXNPSnapshot()
+        while done.wait(timeout: .now()) == .timedOut {
+            guard LXNPSegmentRead(reader, &read) else {
+                continue
+            }
+            // Every field of a snapshot is written with the same value.
+            XCTAssertEqual(read.position, read.timestamp)
+            XCTAssertEqual(read.position, read.duration)
+            XCTAssertEqual(UInt64(read.position), read.trackGeneration)
+        }
+        XCTAssertTrue(LXNPSegmentRead(reader, &read))
+        XCTAssertEqual(read.position, Double(writes))
+    }
+}
+
+#endif
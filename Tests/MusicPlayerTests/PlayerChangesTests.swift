@@ -0,0 +1,69 @@
+//
+//  PlayerChangesTests.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import XCTest
+@testable import MusicPlayer
+
+final class PlayerChangesTests: XCTestCase {
+    
+    private let track = MusicTrack(id: "1", title: "Title", album: "Album", artist: "Artist", duration: 200)
+    
+    func testMetadataOfSameTrack() {
+        var retitled = track
+        retitled.title = "Other Title"
+        let changes = PlayerChanges(from: (track, .paused(time: 0)), to: (retitled, .paused(time: 0)))
+        XCTAssertEqual(changes, [.title])
+    }
+    
+    func testTrackChange() {
+        let other = MusicTrack(id: "2", title: "Title", album: "Album", artist: "Artist", duration: 200)
+        let changes = PlayerChanges(from: (track, .paused(time: 0)), to: (other, .paused(time: 0)))
+        XCTAssertEqual(changes, [.track, .metadata])
+    }
+    
+    func testStateChanges() {
+        XCTAssertEqual(PlayerChanges(stateFrom: .paused(time: 10), to: .playing(time: 10)), [.stateKind])
+        XCTAssertEqual(PlayerChanges(stateFrom: .paused(time: 10), to: .paused(time: 30)), [.positionJump])
+        XCTAssertEqual(PlayerChanges(stateFrom: .paused(time: 10), to: .paused(time: 10.5)), [])
+        XCTAssertEqual(PlayerChanges(stateFrom: .stopped, to: .stopped), [])
+    }
+    
+    func testOnlyComparedFields() {
+        let other = MusicTrack(id: "2", title: "Other", album: nil, artist: nil)
+        let old = (track: Optional(track), state: PlaybackState.paused(time: 0))
+        let new = (track: Optional(other), state: PlaybackState.playing(time: 0))
+        XCTAssertEqual(PlayerChanges(from: old, to: new, comparing: [.stateKind]), [.stateKind])
+        XCTAssertEqual(PlayerChanges(from: old, to: new, comparing: [.track]), [.track, .metadata])
+        
+        var retitled = track
+        retitled.title = "Other Title"
+        XCTAssertEqual(PlayerChanges(metadataFrom: track, to: retitled, comparing: [.artist]), [])
+    }
+    
+    func testAutomaticIdentityTrustsDifferentIDs() {
+        // Same content under two real ids: a repeated track, not the same play.
+        let replay = MusicTrack(id: "2", title: "Title", album: "Album", artist: "Artist", duration: 200)
+        XCTAssertFalse(track.isSameTrack(as: replay, policy: .automatic))
+        XCTAssertTrue(track.isSameTrack(as: replay, policy: .content))
+        
+        // A placeholder id leaves it to the content.
+        let placeholder = MusicTrack(id: "/org/mpris/MediaPlayer2/TrackList/NoTrack", title: "title ", album: "ALBUM", artist: "Artist", duration: 201)
+        XCTAssertTrue(track.isSameTrack(as: placeholder, policy: .automatic))
+        XCTAssertFalse(track.isSameTrack(as: placeholder, policy: .backendID))
+    }
+    
+    func testFingerprintFollowsEdits() {
+        var edited = track
+        let fingerprint = edited.fingerprint
+        XCTAssertEqual(edited.fingerprint, fingerprint)
+        edited.title = "Other Title"
+        XCTAssertNotEqual(edited.fingerprint, fingerprint)
+        XCTAssertEqual(track.fingerprint, fingerprint)
+    }
+}
@@ -0,0 +1,101 @@
+//
+//  PlayerCodingTests.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import XCTest
+@testable import MusicPlayer
+
+final class PlayerCodingTests: XCTestCase {
+    
+    private let track = MusicTrack(id: "42", title: "Title", album: "Album", artist: "Ärtist", duration: 215.5, fileURL: URL(string: "file:///music/track.flac"))
+    
+    private func encoded(_ track: MusicTrack?, _ state: PlaybackState) -> [UInt8] {
+        var encoder = PlayerBinaryEncoder()
+        encoder.encodeVersion()
+        encoder.encode(track)
+        encoder.encode(state)
+        return encoder.bytes
+    }
+    
+    func testRoundTrip() {
+        let states: [PlaybackState] = [.stopped, .playing(start: Date(timeIntervalSince1970: 1_600_000_000)), .paused(time: 12.5), .fastForwarding(time: 3), .rewinding(time: 4)]
+        for state in states {
+            var decoder = PlayerBinaryDecoder(encoded(track, state))
+            XCTAssertTrue(decoder.decodeVersion())
+            guard let decoded = decoder.decodeTrack(), let decodedTrack = decoded else {
+                XCTFail("no track decoded")
+                return
+            }
+            XCTAssertEqual(decodedTrack.id, track.id)
+            XCTAssertEqual(decodedTrack.title, track.title)
+            XCTAssertEqual(decodedTrack.album, track.album)
+            XCTAssertEqual(decodedTrack.artist, track.artist)
+            XCTAssertEqual(decodedTrack.duration, track.duration)
+            XCTAssertEqual(decodedTrack.fileURL, track.fileURL)
+            XCTAssertEqual(decoder.decodeState(), state)
+            XCTAssertTrue(decoder.isAtEnd)
+        }
+    }
+    
+    func testNoTrack() {
+        var decoder = PlayerBinaryDecoder(encoded(nil, .stopped))
+        XCTAssertTrue(decoder.decodeVersion())
+        let decoded = decoder.decodeTrack()
+        XCTAssertNotNil(decoded)
+        XCTAssertNil(decoded ?? nil)
+        XCTAssertEqual(decoder.decodeState(), .stopped)
+        XCTAssertTrue(decoder.isAtEnd)
+    }
+    
+    func testTruncatedInput() {
+        let bytes = encoded(track, .paused(time: 12.5))
+        // Every prefix is malformed somewhere, and none reads out of bounds.
+        for count in 1..<bytes.count {
+            var decoder = PlayerBinaryDecoder(Array(bytes.prefix(count)))
+            XCTAssertTrue(decoder.decodeVersion())
+            if let decoded = decoder.decodeTrack() {
+                XCTAssertNotNil(decoded)
+                XCTAssertNil(decoder.decodeState(), "\(count) bytes")
+            }
+        }
+    }
+    
+    func testMalformedInput() {
+        var unknownTrackTag = PlayerBinaryDecoder([PlayerBinaryEncoder.version, 7])
+        XCTAssertTrue(unknownTrackTag.decodeVersion())
+        XCTAssertNil(unknownTrackTag.decodeTrack())
+        
+        var unknownStateKind = PlayerBinaryDecoder([PlayerBinaryEncoder.version, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0])
+        XCTAssertTrue(unknownStateKind.decodeVersion())
+        XCTAssertNotNil(unknownStateKind.decodeTrack())
+        XCTAssertNil(unknownStateKind.decodeState())
+        
+        var bytes = encoded(track, .stopped)
+        bytes[0] = PlayerBinaryEncoder.version &+ 1
+        var otherVersion = PlayerBinaryDecoder(bytes)
+        XCTAssertFalse(otherVersion.decodeVersion())
+        
+        var empty = PlayerBinaryDecoder([])
+        XCTAssertFalse(empty.decodeVersion())
+        XCTAssertNil(empty.decodeTrack())
+        XCTAssertNil(empty.decodeState())
+    }
+    
+    func testStateCacheSnapshot() {
+        let player = PlayerStateCache.Snapshot.Player(identifier: "test", track: track, playbackState: .paused(time: 30))
+        let snapshot = PlayerStateCache.Snapshot(players: [player], designatedIdentifier: "test", savedAt: Date(timeIntervalSince1970: 1_600_000_000))
+        let bytes = snapshot.binaryRepresentation
+        let decoded = PlayerStateCache.Snapshot(binaryRepresentation: bytes)
+        XCTAssertEqual(decoded?.designatedIdentifier, "test")
+        XCTAssertEqual(decoded?.savedAt, snapshot.savedAt)
+        XCTAssertEqual(decoded?.players.first?.track?.title, track.title)
+        XCTAssertEqual(decoded?.players.first?.playbackState, .paused(time: 30))
+        XCTAssertNil(PlayerStateCache.Snapshot(binaryRepresentation: Array(bytes.dropLast())))
+        XCTAssertNil(PlayerStateCache.Snapshot(binaryRepresentation: Array("{\"players\":[]}".utf8)))
+    }
+}
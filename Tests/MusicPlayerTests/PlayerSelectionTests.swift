@@ -0,0 +1,108 @@
+//
+//  PlayerSelectionTests.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import XCTest
+@testable import MusicPlayer
+
+final class PlayerSelectionTests: XCTestCase {
+    
+    private final class Player {
+        let identifier: String
+        var state: PlaybackState
+        
+        init(_ identifier: String, _ state: PlaybackState = .paused(time: 0)) {
+            self.identifier = identifier
+            self.state = state
+        }
+    }
+    
+    private func select(_ selector: inout PlayerSelector, from players: [Player], current: Player?, at now: TimeInterval) -> (player: Player?, recheckAfter: TimeInterval?) {
+        return selector.select(from: players, current: current, at: now, state: { $0.state }, identifier: { $0.identifier })
+    }
+    
+    func testDefaultKeepsPlayingPlayer() {
+        let a = Player("a", .playing(time: 0))
+        let b = Player("b", .playing(time: 0))
+        var selector = PlayerSelector(policy: .default)
+        XCTAssert(select(&selector, from: [a, b], current: nil, at: 0).player === a)
+        XCTAssert(select(&selector, from: [a, b], current: b, at: 1).player === b)
+        
+        // Until it stops.
+        b.state = .paused(time: 1)
+        XCTAssert(select(&selector, from: [a, b], current: b, at: 2).player === a)
+        
+        // Nothing playing: the first paused player, nothing if all stopped.
+        a.state = .paused(time: 2)
+        XCTAssert(select(&selector, from: [a, b], current: nil, at: 3).player === a)
+        a.state = .stopped
+        b.state = .stopped
+        XCTAssertNil(select(&selector, from: [a, b], current: nil, at: 4).player)
+    }
+    
+    func testPriority() {
+        let a = Player("a", .playing(time: 0))
+        let b = Player("b", .playing(time: 0))
+        var selector = PlayerSelector(policy: PlayerSelectionPolicy(priority: ["b"], keepsPlayingPlayer: false))
+        XCTAssert(select(&selector, from: [a, b], current: a, at: 0).player === b)
+        
+        // A playing player still beats a paused one of higher priority.
+        b.state = .paused(time: 0)
+        XCTAssert(select(&selector, from: [a, b], current: b, at: 1).player === a)
+    }
+    
+    func testDenied() {
+        let a = Player("a", .playing(time: 0))
+        let b = Player("b@system", .paused(time: 0))
+        var policy = PlayerSelectionPolicy(denied: ["a"], switchDelay: 10)
+        var selector = PlayerSelector(policy: policy)
+        // A denied player is replaced at once, whatever the delay.
+        let selection = select(&selector, from: [a, b], current: a, at: 0)
+        XCTAssert(selection.player === b)
+        XCTAssertNil(selection.recheckAfter)
+        
+        // Identifiers match across buses.
+        policy.denied = ["b"]
+        selector.policy = policy
+        XCTAssert(select(&selector, from: [a, b], current: b, at: 1).player === a)
+    }
+    
+    func testLastActiveWithSwitchDelay() {
+        let a = Player("a", .playing(time: 0))
+        let b = Player("b")
+        var selector = PlayerSelector(policy: .lastActive)
+        XCTAssert(select(&selector, from: [a, b], current: nil, at: 0).player === a)
+        
+        b.state = .playing(time: 0)
+        var selection = select(&selector, from: [a, b], current: a, at: 10)
+        XCTAssert(selection.player === a)
+        XCTAssertEqual(selection.recheckAfter, 2)
+        selection = select(&selector, from: [a, b], current: a, at: 11)
+        XCTAssert(selection.player === a)
+        XCTAssertEqual(selection.recheckAfter, 1)
+        selection = select(&selector, from: [a, b], current: a, at: 12)
+        XCTAssert(selection.player === b)
+        XCTAssertNil(selection.recheckAfter)
+        XCTAssertEqual(selector.statistics.switches, 2)
+        XCTAssertEqual(selector.statistics.averageTenure, 12)
+        
+        // A challenger that stops in time never takes over.
+        a.state = .paused(time: 0)
+        XCTAssert(select(&selector, from: [a, b], current: b, at: 20).player === b)
+        a.state = .playing(time: 0)
+        selection = select(&selector, from: [a, b], current: b, at: 21)
+        XCTAssert(selection.player === b)
+        XCTAssertEqual(selection.recheckAfter, 2)
+        a.state = .paused(time: 1)
+        selection = select(&selector, from: [a, b], current: b, at: 22)
+        XCTAssert(selection.player === b)
+        XCTAssertNil(selection.recheckAfter)
+        XCTAssertEqual(selector.statistics.switches, 2)
+        XCTAssertEqual(selector.statistics.suppressedSwitches, 1)
+    }
+}
@@ -0,0 +1,101 @@
+//
+//  VirtualPlayerTests.swift
+//  LyricsX - https://github.com/ddddxxx/LyricsX
+//
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at https://mozilla.org/MPL/2.0/.
+//
+
+import XCTest
+import MusicPlayer
+
+final class VirtualPlayerTests: XCTestCase {
+    
+    private func tracks(_ durations: [TimeInterval?]) -> [MusicTrack] {
+        return durations.enumerated().map { index, duration in
+            MusicTrack(id: "\(index)", title: "Track \(index)", album: nil, artist: nil, duration: duration)
+        }
+    }
+    
+    func testAdvancesThroughQueue() {
+        let clock = ManualSimulationClock()
+        let player = MusicPlayers.Virtual(queue: tracks([100, nil, 50]), clock: clock)
+        XCTAssertEqual(player.queueIndex, 0)
+        XCTAssertEqual(player.playbackState, .paused(time: 0))
+        XCTAssertEqual(clock.pendingCount, 0)
+        
+        player.resume()
+        XCTAssertEqual(clock.pendingCount, 1)
+        clock.advance(by: 99)
+        XCTAssertEqual(player.queueIndex, 0)
+        XCTAssertEqual(player.playbackTime, 99)
+        clock.advance(by: 1)
+        XCTAssertEqual(player.queueIndex, 1)
+        XCTAssertEqual(player.playbackTime, 0)
+        XCTAssertTrue(player.playbackState.isPlaying)
+        
+        // Tracks without a duration last `defaultTrackDuration`.
+        clock.advance(by: player.defaultTrackDuration)
+        XCTAssertEqual(player.queueIndex, 2)
+        clock.advance(by: 50)
+        XCTAssertNil(player.queueIndex)
+        XCTAssertNil(player.currentTrack)
+        XCTAssertEqual(player.playbackState, .stopped)
+        XCTAssertEqual(clock.pendingCount, 0)
+    }
+    
+    func testPauseAndSeek() {
+        let clock = ManualSimulationClock()
+        let player = MusicPlayers.Virtual(queue: tracks([100, 100]), clock: clock)
+        player.resume()
+        clock.advance(by: 10)
+        player.pause()
+        XCTAssertEqual(clock.pendingCount, 0)
+        clock.advance(by: 1000)
+        XCTAssertEqual(player.queueIndex, 0)
+        XCTAssertEqual(player.playbackTime, 10)
+        
+        player.playbackTime = 95
+        player.resume()
+        clock.advance(by: 4)
+        XCTAssertEqual(player.queueIndex, 0)
+        clock.advance(by: 1)
+        XCTAssertEqual(player.queueIndex, 1)
+    }
+    
+    func testRepeatModes() {
+        let clock = ManualSimulationClock()
+        let player = MusicPlayers.Virtual(queue: tracks([10, 20]), clock: clock, repeatMode: .one)
+        player.resume()
+        clock.advance(by: 100)
+        XCTAssertEqual(player.queueIndex, 0)
+        XCTAssertEqual(player.playbackTime, 0)
+        
+        player.repeatMode = .all
+        // 10 to finish the first track, 20 for the second, back to the first.
+        clock.advance(by: 30)
+        XCTAssertEqual(player.queueIndex, 0)
+        XCTAssertTrue(player.playbackState.isPlaying)
+    }
+    
+    func testShuffleIsReproducible() {
+        func playOrder(seed: UInt64) -> [Int] {
+            let clock = ManualSimulationClock()
+            let player = MusicPlayers.Virtual(queue: tracks(Array(repeating: 60, count: 10)), clock: clock, repeatMode: .all, shuffleMode: .on, seed: seed)
+            player.resume()
+            var order: [Int] = []
+            for _ in 0..<30 {
+                order.append(player.queueIndex!)
+                XCTAssertTrue(clock.runNext())
+            }
+            return order
+        }
+        let order = playOrder(seed: 42)
+        XCTAssertEqual(order, playOrder(seed: 42))
+        // Every pass plays each track once.
+        for pass in stride(from: 0, to: order.count, by: 10) {
+            XCTAssertEqual(order[pass..<pass + 10].sorted(), Array(0..<10))
+        }
+    }
+}